@@ -1,6 +1,36 @@
 #include <QCoreApplication>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Heap bytes requested so far, for the benchmark in main().
+static size_t allocatedBytes = 0;
+
+void* operator new(size_t size) {
+    allocatedBytes += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
 
 // Product class
 class Computer {
@@ -17,7 +47,7 @@ public:
         storage_ = storage;
     }
 
-    void display() {
+    void display() const {
         std::cout << "CPU: " << cpu_ << std::endl;
         std::cout << "Memory: " << memory_ << std::endl;
         std::cout << "Storage: " << storage_ << std::endl;
@@ -61,10 +91,164 @@ public:
         return computer_;
     }
 
+    // Hands the product over instead of copying it; the builder is spent.
+    Computer build() && {
+        return std::move(computer_);
+    }
+
 private:
     Computer computer_;
 };
 
+// Compact id for an interned part name. Id 0 is always the empty name,
+// so a zero-initialized record expands to a computer with no parts set.
+using PartId = uint16_t;
+constexpr PartId NoPart = 0;
+
+// Interns part names. Each distinct name is stored once; lookups by
+// string_view do not allocate. Ids and names stay valid for the table's
+// lifetime.
+class PartTable {
+public:
+    PartTable() {
+        intern(""); // NoPart
+    }
+
+    PartId intern(std::string_view name) {
+        auto found = ids_.find(name);
+        if (found != ids_.end()) {
+            return found->second;
+        }
+        if (names_.size() > UINT16_MAX) {
+            throw std::length_error("Too many distinct part names");
+        }
+        names_.emplace_back(name);
+        PartId id = static_cast<PartId>(names_.size() - 1);
+        ids_.emplace(names_.back(), id);
+        return id;
+    }
+
+    const std::string& name(PartId id) const {
+        return names_[id];
+    }
+
+    // Distinct part names, not counting the reserved empty one.
+    size_t size() const {
+        return names_.size() - 1;
+    }
+
+private:
+    std::deque<std::string> names_; // deque: growth never moves a name
+    std::unordered_map<std::string_view, PartId> ids_;
+};
+
+// Interned product: three ids, 6 bytes.
+struct ComputerRecord {
+    PartId cpu;
+    PartId memory;
+    PartId storage;
+
+    Computer expand(const PartTable& parts) const {
+        Computer computer;
+        computer.setCPU(parts.name(cpu));
+        computer.setMemory(parts.name(memory));
+        computer.setStorage(parts.name(storage));
+        return computer;
+    }
+};
+
+// Bump allocator for ComputerRecords: fixed-size blocks, never moved,
+// freed all at once by clear().
+class ComputerArena {
+public:
+    static const size_t BlockRecords = 4096;
+
+    ComputerRecord& allocate() {
+        if (used_ == BlockRecords || blocks_.empty()) {
+            if (next_ == blocks_.size()) {
+                blocks_.push_back(std::make_unique<ComputerRecord[]>(BlockRecords));
+            }
+            ++next_;
+            used_ = 0;
+        }
+        ++count_;
+        return blocks_[next_ - 1][used_++];
+    }
+
+    // Keeps the blocks for reuse.
+    void clear() {
+        next_ = 0;
+        used_ = BlockRecords;
+        count_ = 0;
+    }
+
+    size_t size() const {
+        return count_;
+    }
+
+    size_t capacityBytes() const {
+        return blocks_.size() * BlockRecords * sizeof(ComputerRecord);
+    }
+
+private:
+    std::vector<std::unique_ptr<ComputerRecord[]>> blocks_;
+    size_t next_ = 0;
+    size_t used_ = BlockRecords;
+    size_t count_ = 0;
+};
+
+// Builder that interns parts and writes the product into an arena.
+// getResult() still returns a full Computer for the generic interface;
+// build() && is the fast path.
+class InternedComputerBuilder : public ComputerBuilder {
+public:
+    InternedComputerBuilder(PartTable& parts, ComputerArena& arena)
+        : parts_(parts), arena_(arena), record_{NoPart, NoPart, NoPart} {
+    }
+
+    void buildCPU(const std::string& cpu) override {
+        record_.cpu = parts_.intern(cpu);
+    }
+
+    void buildMemory(const std::string& memory) override {
+        record_.memory = parts_.intern(memory);
+    }
+
+    void buildStorage(const std::string& storage) override {
+        record_.storage = parts_.intern(storage);
+    }
+
+    InternedComputerBuilder& cpu(std::string_view name) {
+        record_.cpu = parts_.intern(name);
+        return *this;
+    }
+
+    InternedComputerBuilder& memory(std::string_view name) {
+        record_.memory = parts_.intern(name);
+        return *this;
+    }
+
+    InternedComputerBuilder& storage(std::string_view name) {
+        record_.storage = parts_.intern(name);
+        return *this;
+    }
+
+    Computer getResult() override {
+        return record_.expand(parts_);
+    }
+
+    ComputerRecord& build() && {
+        ComputerRecord& record = arena_.allocate();
+        record = record_;
+        return record;
+    }
+
+private:
+    PartTable& parts_;
+    ComputerArena& arena_;
+    ComputerRecord record_;
+};
+
 // Director
 class ComputerAssembler {
 public:
@@ -87,5 +271,80 @@ int main(int argc, char *argv[])
     std::cout << "Desktop Computer Configuration:" << std::endl;
     desktop.display();
 
+    PartTable parts;
+    ComputerArena arena;
+    InternedComputerBuilder quoteBuilder(parts, arena);
+    quoteBuilder.cpu("AMD Ryzen 9 7950X3D").memory("64GB DDR5-6000").storage("2TB NVMe PCIe 4.0 SSD");
+    ComputerRecord& quote = std::move(quoteBuilder).build();
+    std::cout << "Quoted Computer Configuration (" << sizeof(quote) << " bytes):" << std::endl;
+    quote.expand(parts).display();
+
+    // 1M quotes from a small vocabulary, three ways.
+    const char* cpus[] = {"Intel Core i9-14900K", "Intel Core i7-14700K", "Intel Core i5-14600K",
+                          "AMD Ryzen 9 7950X3D", "AMD Ryzen 7 7800X3D", "AMD Ryzen 5 7600X"};
+    const char* memories[] = {"16GB DDR5-5600", "32GB DDR5-6000", "64GB DDR5-6000",
+                              "128GB DDR5-4800 ECC"};
+    const char* storages[] = {"512GB NVMe PCIe 4.0 SSD", "1TB NVMe PCIe 4.0 SSD",
+                              "2TB NVMe PCIe 4.0 SSD", "4TB SATA HDD 7200rpm"};
+    const size_t builds = 1000000;
+    auto quoteParts = [&](size_t i, const char*& cpu, const char*& memory, const char*& storage) {
+        cpu = cpus[i % 6];
+        memory = memories[(i / 6) % 4];
+        storage = storages[(i / 24) % 4];
+    };
+    auto report = [&](const char* label, std::chrono::steady_clock::duration elapsed, size_t bytes) {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << label << ": " << builds / seconds / 1e6 << "M builds/s, "
+                  << double(bytes) / builds << " heap bytes allocated per configuration" << std::endl;
+    };
+
+    std::vector<Computer> copied;
+    size_t before = allocatedBytes;
+    auto start = std::chrono::steady_clock::now();
+    copied.reserve(builds);
+    for (size_t i = 0; i < builds; ++i) {
+        const char *cpu, *memory, *storage;
+        quoteParts(i, cpu, memory, storage);
+        DesktopComputerBuilder builder;
+        builder.buildCPU(cpu);
+        builder.buildMemory(memory);
+        builder.buildStorage(storage);
+        copied.push_back(builder.getResult());
+    }
+    report("std::string, getResult() copy", std::chrono::steady_clock::now() - start,
+           allocatedBytes - before);
+    copied = std::vector<Computer>();
+
+    std::vector<Computer> moved;
+    before = allocatedBytes;
+    start = std::chrono::steady_clock::now();
+    moved.reserve(builds);
+    for (size_t i = 0; i < builds; ++i) {
+        const char *cpu, *memory, *storage;
+        quoteParts(i, cpu, memory, storage);
+        DesktopComputerBuilder builder;
+        builder.buildCPU(cpu);
+        builder.buildMemory(memory);
+        builder.buildStorage(storage);
+        moved.push_back(std::move(builder).build());
+    }
+    report("std::string, build() && move", std::chrono::steady_clock::now() - start,
+           allocatedBytes - before);
+    moved = std::vector<Computer>();
+
+    arena.clear();
+    before = allocatedBytes;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < builds; ++i) {
+        const char *cpu, *memory, *storage;
+        quoteParts(i, cpu, memory, storage);
+        InternedComputerBuilder builder(parts, arena);
+        builder.cpu(cpu).memory(memory).storage(storage);
+        std::move(builder).build();
+    }
+    report("interned, arena build() &&", std::chrono::steady_clock::now() - start,
+           allocatedBytes - before);
+    std::cout << arena.size() << " records, " << parts.size() << " distinct parts" << std::endl;
+
     return a.exec();
 }
@@ -1,6 +1,18 @@
 #include <QCoreApplication>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
+#include <vector>
 
 // Product class
 class Pizza {
@@ -36,6 +48,8 @@ private:
 // Abstract builder class
 class PizzaBuilder {
 public:
+    virtual ~PizzaBuilder() = default;
+    virtual void reset() = 0; // start a fresh pizza
     virtual void buildDough() = 0;
     virtual void buildSauce() = 0;
     virtual void buildTopping() = 0;
@@ -45,6 +59,11 @@ public:
 // Concrete builder for a specific type of pizza
 class HawaiianPizzaBuilder : public PizzaBuilder {
 public:
+    void reset() override
+    {
+        pizza = Pizza();
+    }
+
     void buildDough() override
     {
         pizza.setDough("Pan Dough");
@@ -69,6 +88,11 @@ private:
 // Concrete builder for another type of pizza
 class SpicyPizzaBuilder : public PizzaBuilder {
 public:
+    void reset() override
+    {
+        pizza = Pizza();
+    }
+
     void buildDough() override
     {
         pizza.setDough("Thin Dough");
@@ -101,6 +125,293 @@ public:
     }
 };
 
+enum class PizzaType { Hawaiian, Spicy, Count };
+
+std::unique_ptr<PizzaBuilder> createBuilder(PizzaType type)
+{
+    switch (type) {
+    case PizzaType::Hawaiian:
+        return std::make_unique<HawaiianPizzaBuilder>();
+    case PizzaType::Spicy:
+        return std::make_unique<SpicyPizzaBuilder>();
+    default:
+        return nullptr;
+    }
+}
+
+struct Order {
+    uint64_t id;
+    PizzaType type;
+    std::chrono::steady_clock::time_point placed;
+};
+
+struct KitchenOptions {
+    unsigned cooks = std::max(1u, std::thread::hardware_concurrency());
+    size_t maxBatch = 16;                 // orders served by one preparation
+    std::chrono::nanoseconds prepTime{0}; // simulated cost of one makePizza()
+};
+
+// Fixed-size latency histogram: each power of two is split into 8
+// linear sub-buckets, so a percentile is exact to within 1/8 of its
+// value. One writer (a cook); readable at any time.
+class LatencyHistogram {
+public:
+    static constexpr int SubBuckets = 8;
+    static constexpr int Buckets = 64 * SubBuckets;
+
+    void record(uint64_t nanos)
+    {
+        counts[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        if (nanos > largest.load(std::memory_order_relaxed)) {
+            largest.store(nanos, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds this histogram's counts into totals; returns the largest value.
+    uint64_t mergeInto(std::vector<uint64_t>& totals) const
+    {
+        totals.resize(Buckets);
+        for (int i = 0; i < Buckets; ++i) {
+            totals[i] += counts[i].load(std::memory_order_relaxed);
+        }
+        return largest.load(std::memory_order_relaxed);
+    }
+
+    // Upper bound (in ns) of the bucket holding percentile p (0..1) of
+    // merged counts.
+    static uint64_t percentile(const std::vector<uint64_t>& totals, uint64_t total, double p)
+    {
+        uint64_t rank = static_cast<uint64_t>(p * total);
+        uint64_t seen = 0;
+        for (int i = 0; i < Buckets; ++i) {
+            seen += totals[i];
+            if (seen > rank) {
+                return upperBound(i);
+            }
+        }
+        return 0;
+    }
+
+private:
+    // Values below SubBuckets get a bucket each; above that, the top bit
+    // picks the power of two and the next three bits the sub-bucket.
+    static int bucketOf(uint64_t value)
+    {
+        if (value < SubBuckets) {
+            return static_cast<int>(value);
+        }
+        int top = 3;
+        while (top < 63 && (value >> (top + 1)) != 0) {
+            ++top;
+        }
+        int shift = top - 3;
+        return (shift + 1) * SubBuckets + static_cast<int>((value >> shift) & (SubBuckets - 1));
+    }
+
+    static uint64_t upperBound(int bucket)
+    {
+        if (bucket < SubBuckets) {
+            return static_cast<uint64_t>(bucket);
+        }
+        int shift = bucket / SubBuckets - 1;
+        uint64_t mantissa = static_cast<uint64_t>(bucket % SubBuckets + SubBuckets);
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::atomic<uint64_t> counts[Buckets] = {};
+    std::atomic<uint64_t> largest{0};
+};
+
+struct KitchenStats {
+    uint64_t orders = 0;
+    uint64_t batches = 0;
+    double p50Us = 0;
+    double p99Us = 0;
+    double p999Us = 0;
+    double maxUs = 0;
+};
+
+// Order-processing engine. Orders queue per pizza type; each cook thread
+// owns one builder per type, takes up to maxBatch orders of the type
+// whose oldest order has waited longest, runs the Cook once on a freshly
+// reset builder and hands every order in the batch its own copy of the
+// result.
+class Kitchen {
+public:
+    using ReadyCallback = std::function<void(const Order&, Pizza&&)>;
+
+    explicit Kitchen(KitchenOptions options = KitchenOptions(), ReadyCallback onReady = nullptr)
+        : options(options), onReady(std::move(onReady))
+    {
+        for (unsigned i = 0; i < std::max(1u, options.cooks); ++i) {
+            latencies.push_back(std::make_unique<LatencyHistogram>());
+        }
+        for (unsigned i = 0; i < std::max(1u, options.cooks); ++i) {
+            cooks.emplace_back([this, i] { cookLoop(*latencies[i]); });
+        }
+    }
+
+    ~Kitchen()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        orderReady.notify_all();
+        for (std::thread& cook : cooks) {
+            cook.join();
+        }
+    }
+
+    uint64_t placeOrder(PizzaType type)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t id = placed++;
+        queues[static_cast<size_t>(type)].push_back(
+            Order{id, type, std::chrono::steady_clock::now()});
+        orderReady.notify_one();
+        return id;
+    }
+
+    // Waits until every order placed so far has been served.
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        allServed.wait(lock, [this] { return served == placed; });
+    }
+
+    // Latencies are kept in one fixed-size histogram per cook, merged
+    // here; cheap enough to call while orders are still flowing.
+    // Percentiles are bucket upper bounds, within 1/8 of the true value.
+    KitchenStats stats() const
+    {
+        std::vector<uint64_t> totals;
+        uint64_t largest = 0;
+        for (const std::unique_ptr<LatencyHistogram>& histogram : latencies) {
+            largest = std::max(largest, histogram->mergeInto(totals));
+        }
+        uint64_t recorded = 0;
+        for (uint64_t count : totals) {
+            recorded += count;
+        }
+        KitchenStats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.orders = served;
+            stats.batches = batches;
+        }
+        if (recorded == 0) {
+            return stats;
+        }
+        auto percentile = [&](double p) {
+            // A bucket's upper bound can exceed the largest sample.
+            return std::min(LatencyHistogram::percentile(totals, recorded, p), largest) / 1000.0;
+        };
+        stats.p50Us = percentile(0.50);
+        stats.p99Us = percentile(0.99);
+        stats.p999Us = percentile(0.999);
+        stats.maxUs = largest / 1000.0;
+        return stats;
+    }
+
+private:
+    void cookLoop(LatencyHistogram& latency)
+    {
+        Cook cook;
+        std::unique_ptr<PizzaBuilder> builders[static_cast<size_t>(PizzaType::Count)];
+        for (size_t t = 0; t < static_cast<size_t>(PizzaType::Count); ++t) {
+            builders[t] = createBuilder(static_cast<PizzaType>(t));
+        }
+        std::vector<Order> batch;
+
+        for (;;) {
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                orderReady.wait(lock, [this] { return stopping || pending() > 0; });
+                if (pending() == 0) {
+                    return;
+                }
+                std::deque<Order>& queue = oldestQueue();
+                size_t take = std::min(options.maxBatch ? options.maxBatch : 1, queue.size());
+                batch.assign(queue.begin(), queue.begin() + static_cast<ptrdiff_t>(take));
+                queue.erase(queue.begin(), queue.begin() + static_cast<ptrdiff_t>(take));
+                if (pending() > 0) {
+                    orderReady.notify_one();
+                }
+            }
+
+            PizzaBuilder& builder = *builders[static_cast<size_t>(batch.front().type)];
+            builder.reset();
+            cook.makePizza(builder);
+            simulatePrep();
+            const Pizza prepared = builder.getPizza();
+
+            for (const Order& order : batch) {
+                Pizza pizza = prepared;
+                if (onReady) {
+                    onReady(order, std::move(pizza));
+                }
+                latency.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - order.placed)
+                        .count()));
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            served += batch.size();
+            ++batches;
+            if (served == placed) {
+                allServed.notify_all();
+            }
+        }
+    }
+
+    void simulatePrep() const
+    {
+        if (options.prepTime.count() == 0) {
+            return;
+        }
+        auto until = std::chrono::steady_clock::now() + options.prepTime;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+
+    // Caller holds the mutex.
+    size_t pending() const
+    {
+        size_t total = 0;
+        for (const std::deque<Order>& queue : queues) {
+            total += queue.size();
+        }
+        return total;
+    }
+
+    std::deque<Order>& oldestQueue()
+    {
+        std::deque<Order>* oldest = nullptr;
+        for (std::deque<Order>& queue : queues) {
+            if (!queue.empty() && (!oldest || queue.front().id < oldest->front().id)) {
+                oldest = &queue;
+            }
+        }
+        return *oldest;
+    }
+
+    KitchenOptions options;
+    ReadyCallback onReady;
+    mutable std::mutex mutex;
+    std::condition_variable orderReady;
+    std::condition_variable allServed;
+    std::deque<Order> queues[static_cast<size_t>(PizzaType::Count)];
+    uint64_t placed = 0;
+    uint64_t served = 0;
+    uint64_t batches = 0;
+    bool stopping = false;
+    std::vector<std::unique_ptr<LatencyHistogram>> latencies; // one per cook
+    std::vector<std::thread> cooks;
+};
+
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
@@ -117,5 +428,48 @@ int main(int argc, char *argv[])
     Pizza spicyPizza = spicyBuilder.getPizza();
     spicyPizza.displayPizza();
 
+    {
+        Kitchen kitchen(KitchenOptions(), [](const Order& order, Pizza&& pizza) {
+            std::cout << "Order " << order.id << ": ";
+            pizza.displayPizza();
+        });
+        kitchen.placeOrder(PizzaType::Spicy);
+        kitchen.placeOrder(PizzaType::Hawaiian);
+        kitchen.drain();
+    }
+
+    // Synthetic peak: 4 front-of-house threads place 50k orders each as
+    // fast as they can; each preparation costs 2 us.
+    const int tills = 4;
+    const int ordersPerTill = 50000;
+    for (size_t maxBatch : {size_t(1), size_t(16)}) {
+        KitchenOptions options;
+        options.maxBatch = maxBatch;
+        options.prepTime = std::chrono::microseconds(2);
+        Kitchen kitchen(options);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> front;
+        for (int t = 0; t < tills; ++t) {
+            front.emplace_back([&kitchen, t] {
+                std::mt19937 rng(t);
+                for (int i = 0; i < ordersPerTill; ++i) {
+                    kitchen.placeOrder(rng() % 4 == 0 ? PizzaType::Spicy : PizzaType::Hawaiian);
+                }
+            });
+        }
+        for (std::thread& till : front) {
+            till.join();
+        }
+        kitchen.drain();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        KitchenStats stats = kitchen.stats();
+        std::cout << options.cooks << " cook(s), batch <= " << maxBatch << ": "
+                  << stats.orders / seconds << " orders/s, " << stats.batches << " batches, latency p50 "
+                  << stats.p50Us << " us, p99 " << stats.p99Us << " us, p99.9 " << stats.p999Us
+                  << " us, max " << stats.maxUs << " us" << std::endl;
+    }
+
     return a.exec();
 }
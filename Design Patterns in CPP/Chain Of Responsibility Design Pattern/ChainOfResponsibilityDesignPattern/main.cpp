@@ -1,72 +1,725 @@
 #include <QCoreApplication>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Handler Interface
 class AuthenticationHandler {
 public:
+    virtual ~AuthenticationHandler() = default;
+
     virtual void
     setNextHandler(AuthenticationHandler* handler)
-        = 0;
+    {
+        nextHandler = handler;
+    }
+
+    // Walks the chain: the first handler that accepts the
+    // request handles it.
     virtual void handleRequest(const std::string& request)
-        = 0;
+    {
+        if (canHandle(request)) {
+            handle(request);
+        }
+        else if (nextHandler != nullptr) {
+            nextHandler->handleRequest(request);
+        }
+        else {
+            std::cout << "Invalid authentication method."
+            << std::endl;
+        }
+    }
+
+    // The one request kind this handler accepts, or empty if
+    // it decides by predicate. A handler with a kind must
+    // accept exactly that kind, so a chain can index it.
+    virtual std::string_view kind() const { return {}; }
+
+    virtual bool canHandle(const std::string& request) const
+    {
+        return request == kind();
+    }
+
+    // Authenticate a request this handler accepted. Returns
+    // whether the credential is valid.
+    virtual bool handle(const std::string& request) = 0;
+
+    // Slow handlers (remote calls, password hashing) run on
+    // a thread pool in an AsyncChain.
+    virtual bool isSlow() const { return false; }
+
+protected:
+    AuthenticationHandler* nextHandler = nullptr;
 };
 
 // Concrete Handlers
 class UsernamePasswordHandler
     : public AuthenticationHandler {
+public:
+    std::string_view kind() const override
+    {
+        return "username_password";
+    }
+
+    bool handle(const std::string&) override
+    {
+        std::cout << "Authenticated using username and "
+        "password."
+        << std::endl;
+        return true;
+    }
+};
+
+class OAuthHandler : public AuthenticationHandler {
+public:
+    std::string_view kind() const override
+    {
+        return "oauth_token";
+    }
+
+    bool handle(const std::string&) override
+    {
+        std::cout << "Authenticated using OAuth token."
+        << std::endl;
+        return true;
+    }
+};
+
+// Predicate-based handler: accepts whatever its predicate
+// accepts, e.g. every request with a given prefix.
+class PredicateHandler : public AuthenticationHandler {
+public:
+    using Predicate = std::function<bool(const std::string&)>;
+    using Action = std::function<bool(const std::string&)>;
+
+    PredicateHandler(Predicate predicate, Action action,
+        bool slow = false)
+        : predicate(std::move(predicate))
+        , action(std::move(action))
+        , slow(slow)
+    {
+    }
+
+    bool canHandle(const std::string& request) const override
+    {
+        return predicate(request);
+    }
+
+    bool handle(const std::string& request) override
+    {
+        return action(request);
+    }
+
+    bool isSlow() const override { return slow; }
+
 private:
-    AuthenticationHandler* nextHandler;
+    Predicate predicate;
+    Action action;
+    bool slow;
+};
 
+struct AuthResult {
+    AuthenticationHandler* handler = nullptr; // who decided
+    bool authenticated = false;
+};
+
+// Compiled form of a handler list. Handlers with a kind go
+// into a hash index (the first one wins for duplicate
+// kinds); predicate handlers stay in a list in chain order.
+// A request goes to the indexed handler for its kind unless a
+// predicate handler that came earlier in the chain accepts it
+// first, which is exactly what walking the chain would do.
+// Cost: one hash lookup plus the predicates ahead of the match.
+class CompiledChain {
 public:
-    void
-    setNextHandler(AuthenticationHandler* handler) override
+    // The handler that would take this request, or nullptr.
+    AuthenticationHandler* find(const std::string& request) const
     {
-        nextHandler = handler;
+        return locate(request).second;
     }
 
-    void handleRequest(const std::string& request) override
+    // Chain position and handler that would take this
+    // request; (NoMatch, nullptr) if none would.
+    std::pair<size_t, AuthenticationHandler*> locate(
+        const std::string& request) const
     {
-        if (request == "username_password") {
-            std::cout << "Authenticated using username and "
-            "password."
-            << std::endl;
+        std::pair<size_t, AuthenticationHandler*> keyed(
+            NoMatch, nullptr);
+        auto found = index.find(request);
+        if (found != index.end()) {
+            keyed = found->second;
         }
-        else if (nextHandler != nullptr) {
-            nextHandler->handleRequest(request);
+        for (const auto& entry : predicates) {
+            if (entry.first > keyed.first) {
+                break;
+            }
+            if (entry.second->canHandle(request)) {
+                return entry;
+            }
+        }
+        return keyed;
+    }
+
+    static const size_t NoMatch
+        = std::numeric_limits<size_t>::max();
+
+    // Find and run the handler, without printing anything
+    // for unknown methods.
+    AuthResult authenticate(const std::string& request) const
+    {
+        AuthResult result;
+        result.handler = find(request);
+        result.authenticated = result.handler != nullptr
+            && result.handler->handle(request);
+        return result;
+    }
+
+    void handleRequest(const std::string& request) const
+    {
+        if (AuthenticationHandler* handler = find(request)) {
+            handler->handle(request);
         }
         else {
             std::cout << "Invalid authentication method."
             << std::endl;
         }
     }
+
+private:
+    friend class ChainBuilder;
+
+    std::unordered_map<std::string,
+        std::pair<size_t, AuthenticationHandler*>>
+        index;
+    std::vector<std::pair<size_t, AuthenticationHandler*>>
+        predicates;
 };
 
-class OAuthHandler : public AuthenticationHandler {
+// Collects handlers in chain order. link() wires them up as a
+// classic chain; compile() builds the indexed form.
+class ChainBuilder {
+public:
+    ChainBuilder& add(AuthenticationHandler& handler)
+    {
+        handlers.push_back(&handler);
+        return *this;
+    }
+
+    AuthenticationHandler* link() const
+    {
+        for (size_t i = 0; i < handlers.size(); ++i) {
+            handlers[i]->setNextHandler(
+                i + 1 < handlers.size() ? handlers[i + 1]
+                                        : nullptr);
+        }
+        return handlers.empty() ? nullptr : handlers.front();
+    }
+
+    CompiledChain compile() const
+    {
+        CompiledChain chain;
+        for (size_t i = 0; i < handlers.size(); ++i) {
+            std::string_view kind = handlers[i]->kind();
+            if (kind.empty()) {
+                chain.predicates.emplace_back(i, handlers[i]);
+            }
+            else {
+                chain.index.emplace(std::string(kind),
+                    std::make_pair(i, handlers[i]));
+            }
+        }
+        return chain;
+    }
+
+    const std::vector<AuthenticationHandler*>& inOrder() const
+    {
+        return handlers;
+    }
+
 private:
-    AuthenticationHandler* nextHandler;
+    std::vector<AuthenticationHandler*> handlers;
+};
 
+struct AuthCacheOptions {
+    size_t shards = 16; // rounded up to a power of two
+    size_t capacity = 65536; // entries across all shards
+    std::chrono::nanoseconds ttl = std::chrono::seconds(30);
+    // Failed credentials are remembered too, but not as long.
+    std::chrono::nanoseconds negativeTtl
+        = std::chrono::seconds(1);
+};
+
+// SipHash-2-4: a keyed 64-bit PRF. Without the key an
+// attacker cannot predict or search for collisions.
+inline uint64_t sipHash24(
+    uint64_t k0, uint64_t k1, const char* data, size_t length)
+{
+    auto rotl = [](uint64_t x, int b) {
+        return (x << b) | (x >> (64 - b));
+    };
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ull;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dull;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ull;
+    uint64_t v3 = k1 ^ 0x7465646279746573ull;
+    auto round = [&] {
+        v0 += v1;
+        v1 = rotl(v1, 13) ^ v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16) ^ v2;
+        v0 += v3;
+        v3 = rotl(v3, 21) ^ v0;
+        v2 += v1;
+        v1 = rotl(v1, 17) ^ v2;
+        v2 = rotl(v2, 32);
+    };
+    auto word = [](const unsigned char* p, size_t n) {
+        uint64_t m = 0;
+        for (size_t i = 0; i < n; ++i) {
+            m |= uint64_t(p[i]) << (8 * i);
+        }
+        return m;
+    };
+
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t full = length & ~size_t(7);
+    for (size_t i = 0; i < full; i += 8) {
+        uint64_t m = word(bytes + i, 8);
+        v3 ^= m;
+        round();
+        round();
+        v0 ^= m;
+    }
+    uint64_t last = (uint64_t(length) << 56)
+        | word(bytes + full, length - full);
+    v3 ^= last;
+    round();
+    round();
+    v0 ^= last;
+    v2 ^= 0xff;
+    round();
+    round();
+    round();
+    round();
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Result cache in front of a CompiledChain. Entries are keyed
+// by a SipHash of the credential and carry a second SipHash,
+// under an independent key, that must also match. Both keys
+// are drawn at random per cache, so the 128 bits cannot be
+// matched by searching offline, and nothing about the
+// credential itself is kept.
+//
+// Each shard has its own lock, map and a FIFO ring of keys
+// that bounds its size: inserting into a full shard evicts
+// its oldest entry. Expired entries are dropped when found.
+class CachedChain {
 public:
-    void
-    setNextHandler(AuthenticationHandler* handler) override
+    CachedChain(const CompiledChain& chain,
+        AuthCacheOptions options = AuthCacheOptions())
+        : chain(chain)
+        , options(options)
     {
-        nextHandler = handler;
+        std::random_device entropy;
+        for (uint64_t& word : keys) {
+            word = (uint64_t(entropy()) << 32) | entropy();
+        }
+        size_t count = 1;
+        while (count < options.shards) {
+            count <<= 1;
+        }
+        shards = std::vector<Shard>(count);
+        size_t perShard = std::max<size_t>(
+            1, (options.capacity + count - 1) / count);
+        for (Shard& shard : shards) {
+            shard.ring.resize(perShard);
+            shard.entries.reserve(perShard);
+        }
     }
 
-    void handleRequest(const std::string& request) override
+    AuthResult authenticate(const std::string& request)
     {
-        if (request == "oauth_token") {
-            std::cout << "Authenticated using OAuth token."
-            << std::endl;
+        uint64_t key = sipHash24(
+            keys[0], keys[1], request.data(), request.size());
+        uint64_t check = sipHash24(
+            keys[2], keys[3], request.data(), request.size());
+        Shard& shard = shards[(key >> 7) & (shards.size() - 1)];
+        int64_t now = nowNs();
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto found = shard.entries.find(key);
+            if (found != shard.entries.end()
+                && found->second.check == check) {
+                if (found->second.expiresNs > now) {
+                    ++shard.hits;
+                    return found->second.result;
+                }
+                shard.entries.erase(found);
+            }
+            ++shard.misses;
         }
-        else if (nextHandler != nullptr) {
-            nextHandler->handleRequest(request);
+
+        // Authenticate outside the lock; a concurrent miss on
+        // the same credential just does the work twice.
+        AuthResult result = chain.authenticate(request);
+        int64_t ttl = (result.authenticated ? options.ttl
+                                            : options.negativeTtl)
+                          .count();
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto inserted = shard.entries.emplace(
+            key, Entry{check, now + ttl, result, shard.next});
+        if (!inserted.second) {
+            inserted.first->second.check = check;
+            inserted.first->second.expiresNs = now + ttl;
+            inserted.first->second.result = result;
+            return result;
         }
-        else {
-            std::cout << "Invalid authentication method."
-            << std::endl;
+        // Evict whatever still owns the slot being reused.
+        uint64_t& slot = shard.ring[shard.next];
+        auto evicted = shard.entries.find(slot);
+        if (evicted != shard.entries.end() && evicted != inserted.first
+            && evicted->second.slot == shard.next) {
+            shard.entries.erase(evicted);
+        }
+        slot = key;
+        shard.next = (shard.next + 1) % shard.ring.size();
+        return result;
+    }
+
+    double hitRate() const
+    {
+        uint64_t hits = 0, total = 0;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            hits += shard.hits;
+            total += shard.hits + shard.misses;
+        }
+        return total ? double(hits) / double(total) : 0.0;
+    }
+
+    size_t size() const
+    {
+        size_t total = 0;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.entries.size();
         }
+        return total;
     }
+
+private:
+    struct Entry {
+        uint64_t check;
+        int64_t expiresNs;
+        AuthResult result;
+        size_t slot; // position in the shard's ring
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+        std::vector<uint64_t> ring; // insertion order
+        size_t next = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    static int64_t nowNs()
+    {
+        return std::chrono::duration_cast<
+            std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now()
+                .time_since_epoch())
+            .count();
+    }
+
+    const CompiledChain& chain;
+    AuthCacheOptions options;
+    uint64_t keys[4]; // two SipHash keys: lookup, check
+    std::vector<Shard> shards;
+};
+
+// Minimal stand-in for C++20 std::span.
+template <typename T>
+class Span {
+public:
+    Span(T* data, size_t size)
+        : first(data)
+        , count(size)
+    {
+    }
+
+    template <typename Container>
+    Span(Container& container)
+        : first(container.data())
+        , count(container.size())
+    {
+    }
+
+    T* data() const { return first; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) const { return first[i]; }
+    T* begin() const { return first; }
+    T* end() const { return first + count; }
+
+private:
+    T* first;
+    size_t count;
+};
+
+// Fixed set of workers draining one task queue.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads
+        = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (unsigned i = 0; i < std::max(1u, threads); ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    size_t size() const { return workers.size(); }
+
+private:
+    void workerLoop()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] {
+                    return stopping || !tasks.empty();
+                });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+struct HandlerStats {
+    AuthenticationHandler* handler;
+    uint64_t requests;
+    double milliseconds;
+};
+
+// Batch mode. handleBatch() routes every request through the
+// compiled index once, then runs the chain stage by stage:
+// each handler gets all of its requests together, in chain
+// order. Stages of slow handlers are cut into chunks and run
+// on the pool; the rest run on the calling thread. The batch
+// completes through a callback or future once its last chunk
+// is done. Requests must outlive the batch.
+class AsyncChain {
+public:
+    using Callback
+        = std::function<void(std::vector<AuthResult>)>;
+
+    AsyncChain(const ChainBuilder& builder, ThreadPool& pool,
+        size_t chunkSize = 256)
+        : chain(builder.compile())
+        , handlers(builder.inOrder())
+        , pool(pool)
+        , chunkSize(std::max<size_t>(1, chunkSize))
+        , stageStats(handlers.size())
+    {
+    }
+
+    void handleBatch(Span<const std::string> requests,
+        Callback done)
+    {
+        auto batch = std::make_shared<Batch>();
+        batch->requests = requests;
+        batch->results.resize(requests.size());
+        batch->done = std::move(done);
+
+        // Route once, then bucket by chain position.
+        std::vector<std::vector<uint32_t>> stages(
+            handlers.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            std::pair<size_t, AuthenticationHandler*> match
+                = chain.locate(requests[i]);
+            if (match.second) {
+                stages[match.first].push_back(uint32_t(i));
+            }
+        }
+
+        // One extra count held by this thread, so the batch
+        // cannot complete while chunks are still being handed
+        // out.
+        batch->remaining = 1;
+        for (size_t h = 0; h < handlers.size(); ++h) {
+            const std::vector<uint32_t>& stage = stages[h];
+            if (stage.empty()) {
+                continue;
+            }
+            if (!handlers[h]->isSlow()) {
+                runStage(*batch, h, stage.data(), stage.size());
+                continue;
+            }
+            auto shared = std::make_shared<std::vector<uint32_t>>(
+                std::move(stages[h]));
+            for (size_t begin = 0; begin < shared->size();
+                 begin += chunkSize) {
+                size_t count = std::min(chunkSize,
+                    shared->size() - begin);
+                batch->remaining.fetch_add(1);
+                pool.submit([this, batch, shared, h, begin,
+                                count] {
+                    runStage(*batch, h, shared->data() + begin,
+                        count);
+                    finish(batch);
+                });
+            }
+        }
+        finish(batch);
+    }
+
+    std::future<std::vector<AuthResult>> handleBatch(
+        Span<const std::string> requests)
+    {
+        auto promise = std::make_shared<
+            std::promise<std::vector<AuthResult>>>();
+        std::future<std::vector<AuthResult>> future
+            = promise->get_future();
+        handleBatch(requests,
+            [promise](std::vector<AuthResult> results) {
+                promise->set_value(std::move(results));
+            });
+        return future;
+    }
+
+    std::vector<HandlerStats> stats() const
+    {
+        std::vector<HandlerStats> result;
+        for (size_t h = 0; h < handlers.size(); ++h) {
+            result.push_back(HandlerStats { handlers[h],
+                stageStats[h].requests.load(),
+                stageStats[h].nanoseconds.load() / 1e6 });
+        }
+        return result;
+    }
+
+private:
+    struct Batch {
+        Span<const std::string> requests { nullptr, 0 };
+        std::vector<AuthResult> results;
+        std::atomic<size_t> remaining { 0 };
+        Callback done;
+    };
+
+    struct alignas(64) StageStats {
+        std::atomic<uint64_t> requests { 0 };
+        std::atomic<uint64_t> nanoseconds { 0 };
+    };
+
+    void runStage(Batch& batch, size_t h,
+        const uint32_t* indices, size_t count)
+    {
+        auto start = std::chrono::steady_clock::now();
+        AuthenticationHandler* handler = handlers[h];
+        for (size_t i = 0; i < count; ++i) {
+            AuthResult& result = batch.results[indices[i]];
+            result.handler = handler;
+            result.authenticated
+                = handler->handle(batch.requests[indices[i]]);
+        }
+        stageStats[h].requests.fetch_add(count,
+            std::memory_order_relaxed);
+        stageStats[h].nanoseconds.fetch_add(
+            uint64_t(std::chrono::duration_cast<
+                std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                         .count()),
+            std::memory_order_relaxed);
+    }
+
+    static void finish(const std::shared_ptr<Batch>& batch)
+    {
+        if (batch->remaining.fetch_sub(1,
+                std::memory_order_acq_rel)
+            == 1) {
+            batch->done(std::move(batch->results));
+        }
+    }
+
+    CompiledChain chain;
+    std::vector<AuthenticationHandler*> handlers;
+    ThreadPool& pool;
+    size_t chunkSize;
+    std::vector<StageStats> stageStats;
+};
+
+// Benchmark handler: one exact kind, counts hits.
+class CountingHandler : public AuthenticationHandler {
+public:
+    explicit CountingHandler(std::string kind)
+        : name(std::move(kind))
+    {
+    }
+
+    std::string_view kind() const override { return name; }
+
+    bool handle(const std::string&) override
+    {
+        ++hits;
+        return true;
+    }
+
+    size_t hits = 0;
+
+private:
+    std::string name;
 };
 
 // Client
@@ -89,8 +742,235 @@ int main(int argc, char *argv[])
     usernamePasswordHandler->handleRequest(
         "invalid_method");
 
+    // The same chain compiled, with a predicate handler in
+    // front for API keys.
+    PredicateHandler apiKeyHandler(
+        [](const std::string& request) {
+            return request.rfind("api_key:", 0) == 0;
+        },
+        [](const std::string&) {
+            std::cout << "Authenticated using API key."
+            << std::endl;
+            return true;
+        });
+    CompiledChain compiled = ChainBuilder()
+                                 .add(apiKeyHandler)
+                                 .add(*usernamePasswordHandler)
+                                 .add(*oauthHandler)
+                                 .compile();
+    compiled.handleRequest("oauth_token");
+    compiled.handleRequest("api_key:1234");
+    compiled.handleRequest("invalid_method");
+
     delete usernamePasswordHandler;
     delete oauthHandler;
 
+    // 64 handlers: 60 exact kinds and 4 predicate handlers
+    // spread through the chain. Requests hit kinds uniformly.
+    std::vector<std::unique_ptr<AuthenticationHandler>> owned;
+    std::vector<std::string> requests;
+    size_t predicateHits = 0;
+    ChainBuilder builder;
+    for (int i = 0; i < 64; ++i) {
+        if (i % 16 == 15) {
+            std::string prefix
+                = "sso" + std::to_string(i) + ":";
+            owned.push_back(std::make_unique<PredicateHandler>(
+                [prefix](const std::string& request) {
+                    return request.compare(
+                               0, prefix.size(), prefix)
+                        == 0;
+                },
+                [&predicateHits](const std::string&) {
+                    ++predicateHits;
+                    return true;
+                }));
+            requests.push_back(prefix + "user");
+        }
+        else {
+            std::string kind
+                = "method_" + std::to_string(i);
+            owned.push_back(
+                std::make_unique<CountingHandler>(kind));
+            requests.push_back(kind);
+        }
+        builder.add(*owned.back());
+    }
+    requests.push_back("unknown_method");
+
+    const size_t rounds = 20000;
+    AuthenticationHandler* head = builder.link();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (const std::string& request : requests) {
+            if (request != "unknown_method") {
+                head->handleRequest(request);
+            }
+        }
+    }
+    auto linear = std::chrono::steady_clock::now() - start;
+    size_t linearPredicateHits = predicateHits;
+
+    CompiledChain chain = builder.compile();
+    predicateHits = 0;
+    size_t misses = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (const std::string& request : requests) {
+            if (request != "unknown_method") {
+                chain.find(request)->handle(request);
+            }
+            else {
+                misses += chain.find(request) == nullptr;
+            }
+        }
+    }
+    auto hashed = std::chrono::steady_clock::now() - start;
+
+    double requestCount = double(rounds) * 64;
+    std::cout << "64 handlers, linear chain: "
+              << std::chrono::duration<double, std::nano>(
+                     linear)
+                     .count()
+            / requestCount
+              << " ns/request, compiled: "
+              << std::chrono::duration<double, std::nano>(
+                     hashed)
+                     .count()
+            / (requestCount + rounds)
+              << " ns/request (predicate hits "
+              << linearPredicateHits << " vs " << predicateHits
+              << ", misses " << misses << ")" << std::endl;
+
+    // Password checks that cost a few microseconds, 2000
+    // distinct credentials (1 in 10 wrong), 400k requests.
+    auto isPassword = [](const std::string& request) {
+        return request.rfind("password:", 0) == 0;
+    };
+    auto checkPassword = [](const std::string& request) {
+        uint64_t digest = 0;
+        for (int round = 0; round < 100; ++round) {
+            for (unsigned char c : request) {
+                digest = (digest ^ c) * 1099511628211ull;
+            }
+        }
+        return request.back() != 'x' || digest == 0;
+    };
+    PredicateHandler passwordHandler(isPassword, checkPassword);
+    CompiledChain passwordChain
+        = ChainBuilder().add(passwordHandler).compile();
+    CachedChain cached(passwordChain);
+
+    std::vector<std::string> credentials;
+    for (int i = 0; i < 2000; ++i) {
+        credentials.push_back("password:user"
+            + std::to_string(i) + ":"
+            + (i % 10 == 0 ? "wrongx" : "secret"));
+    }
+    std::mt19937 rng(11);
+    std::vector<const std::string*> stream;
+    for (int i = 0; i < 400000; ++i) {
+        stream.push_back(&credentials[rng() % credentials.size()]);
+    }
+
+    auto measure = [&](auto&& authenticate) {
+        std::vector<double> latencies;
+        latencies.reserve(stream.size());
+        size_t accepted = 0;
+        for (const std::string* request : stream) {
+            auto begin = std::chrono::steady_clock::now();
+            accepted += authenticate(*request).authenticated;
+            latencies.push_back(
+                std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "p50 " << latencies[latencies.size() / 2]
+                  << " ns, p99 "
+                  << latencies[latencies.size() * 99 / 100]
+                  << " ns, " << accepted << " accepted";
+    };
+
+    std::cout << "Uncached chain: ";
+    measure([&](const std::string& request) {
+        return passwordChain.authenticate(request);
+    });
+    std::cout << std::endl << "Cached chain: ";
+    measure([&](const std::string& request) {
+        return cached.authenticate(request);
+    });
+    std::cout << ", hit rate " << cached.hitRate() * 100
+              << "%, " << cached.size() << " entries"
+              << std::endl;
+
+    // Batches of 10k: six keyed kinds plus slow password
+    // checks (30% of requests), pool vs one at a time.
+    PredicateHandler slowPasswordHandler(
+        isPassword, checkPassword, true);
+    std::vector<std::unique_ptr<CountingHandler>> fast;
+    ChainBuilder batchBuilder;
+    for (int i = 0; i < 6; ++i) {
+        fast.push_back(std::make_unique<CountingHandler>(
+            "method_" + std::to_string(i)));
+        batchBuilder.add(*fast.back());
+    }
+    batchBuilder.add(slowPasswordHandler);
+    CompiledChain serialChain = batchBuilder.compile();
+
+    std::vector<std::string> batchRequests;
+    for (int i = 0; i < 10000; ++i) {
+        batchRequests.push_back(rng() % 10 < 3
+                ? credentials[rng() % credentials.size()]
+                : "method_" + std::to_string(rng() % 7));
+    }
+
+    const int batches = 50;
+    size_t serialAccepted = 0;
+    start = std::chrono::steady_clock::now();
+    for (int b = 0; b < batches; ++b) {
+        for (const std::string& request : batchRequests) {
+            serialAccepted
+                += serialChain.authenticate(request)
+                       .authenticated;
+        }
+    }
+    double serialSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start)
+                               .count();
+
+    ThreadPool pool;
+    AsyncChain asyncChain(batchBuilder, pool);
+    size_t batchAccepted = 0;
+    start = std::chrono::steady_clock::now();
+    std::vector<std::future<std::vector<AuthResult>>> inFlight;
+    for (int b = 0; b < batches; ++b) {
+        inFlight.push_back(asyncChain.handleBatch(
+            Span<const std::string>(batchRequests)));
+    }
+    for (auto& future : inFlight) {
+        for (const AuthResult& result : future.get()) {
+            batchAccepted += result.authenticated;
+        }
+    }
+    double batchSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start)
+                              .count();
+
+    double total = double(batches) * batchRequests.size();
+    std::cout << "One at a time: " << total / serialSeconds
+              << " requests/s, batched on " << pool.size()
+              << " worker(s): " << total / batchSeconds
+              << " requests/s (accepted " << serialAccepted
+              << " vs " << batchAccepted << ")" << std::endl;
+    for (const HandlerStats& stage : asyncChain.stats()) {
+        std::cout << "  "
+                  << (stage.handler == &slowPasswordHandler
+                             ? std::string("password")
+                             : std::string(stage.handler->kind()))
+                  << ": " << stage.requests << " requests, "
+                  << stage.milliseconds << " ms" << std::endl;
+    }
+
     return a.exec();
 }
@@ -1,5 +1,10 @@
 #include <QCoreApplication>
+#include <cstddef>
 #include <iostream>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 // Receiver
 class Receiver {
@@ -9,16 +14,40 @@ public:
     {
         std::cout << "Receiver is performing an action" << std::endl;
     }
+
+    // Reverts performAction.
+    void revertAction()
+    {
+        std::cout << "Receiver is reverting the action" << std::endl;
+    }
 };
 
 // Command interface
 class Command {
 public:
+    virtual ~Command() = default;
+
     // The execute method is declared in the Command
     // interface.
     virtual void execute() = 0;
+
+    // The undo method reverts what execute did.
+    virtual void undo() = 0;
+
+    // Copies the command into caller-provided storage so the
+    // history can keep it inline instead of on the heap.
+    virtual Command* cloneInto(void* storage, size_t capacity) const = 0;
 };
 
+template <typename T>
+Command* placeClone(const T& command, void* storage, size_t capacity)
+{
+    if (sizeof(T) > capacity) {
+        throw std::length_error("Command does not fit in history slot");
+    }
+    return new (storage) T(command);
+}
+
 // Concrete Command
 class ConcreteCommand : public Command {
 private:
@@ -34,21 +63,283 @@ public:
 
     // The execute method calls the action on the Receiver.
     void execute() { receiver.performAction(); }
+
+    // The undo method calls the revert action on the Receiver.
+    void undo() override { receiver.revertAction(); }
+
+    Command* cloneInto(void* storage, size_t capacity) const override
+    {
+        return placeClone(*this, storage, capacity);
+    }
+};
+
+// CommandFn: owning, type-erased command value. Anything up to
+// InlineSize bytes (a concrete command, a small lambda) is stored inside
+// the CommandFn itself, larger objects go to the heap. Calls go through
+// a static table of function pointers, one per stored type.
+class CommandFn {
+public:
+    static constexpr size_t InlineSize = 48;
+
+    CommandFn() = default;
+
+    // Non-owning: forwards to a Command the caller keeps alive.
+    CommandFn(Command* command) { emplace<Borrowed>(Borrowed{command}); }
+
+    // Owning: commands run execute(), any other callable runs operator().
+    template <typename F,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, CommandFn>
+                                          && !std::is_pointer_v<std::decay_t<F>>>>
+    CommandFn(F&& f)
+    {
+        emplace<std::decay_t<F>>(std::forward<F>(f));
+    }
+
+    CommandFn(const CommandFn& other)
+    {
+        if (other.ops != nullptr) {
+            other.ops->copy(storage, other.storage);
+            ops = other.ops;
+        }
+    }
+
+    CommandFn(CommandFn&& other) noexcept
+    {
+        if (other.ops != nullptr) {
+            other.ops->move(storage, other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    CommandFn& operator=(CommandFn other) noexcept
+    {
+        reset();
+        if (other.ops != nullptr) {
+            other.ops->move(storage, other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+        return *this;
+    }
+
+    ~CommandFn() { reset(); }
+
+    void operator()() { ops->invoke(storage); }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    // The wrapped Command, or nullptr for plain callables.
+    Command* command() { return ops != nullptr ? ops->command(storage) : nullptr; }
+
+private:
+    struct Borrowed {
+        Command* command;
+    };
+
+    struct Ops {
+        void (*invoke)(void*);
+        Command* (*command)(void*);
+        void (*copy)(void* dst, const void* src);
+        void (*move)(void* dst, void* src); // move-constructs dst, destroys src
+        void (*destroy)(void*);
+    };
+
+    template <typename T>
+    static constexpr bool fitsInline = sizeof(T) <= InlineSize
+        && alignof(T) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<T>;
+
+    template <typename T>
+    static void call(T& target)
+    {
+        if constexpr (std::is_same_v<T, Borrowed>) {
+            target.command->execute();
+        } else if constexpr (std::is_base_of_v<Command, T>) {
+            target.T::execute(); // type is known: skip the virtual call
+        } else {
+            target();
+        }
+    }
+
+    template <typename T>
+    static Command* commandOf(T& target)
+    {
+        if constexpr (std::is_same_v<T, Borrowed>) {
+            return target.command;
+        } else if constexpr (std::is_base_of_v<Command, T>) {
+            return &target;
+        } else {
+            return nullptr;
+        }
+    }
+
+    template <typename T>
+    static T& object(void* storage)
+    {
+        if constexpr (fitsInline<T>) {
+            return *static_cast<T*>(storage);
+        } else {
+            return **static_cast<T**>(storage);
+        }
+    }
+
+    template <typename T>
+    static const Ops* opsFor()
+    {
+        static const Ops table = {
+            [](void* s) { call(object<T>(s)); },
+            [](void* s) { return commandOf(object<T>(s)); },
+            [](void* dst, const void* src) {
+                const T& from = object<T>(const_cast<void*>(src));
+                if constexpr (fitsInline<T>) {
+                    new (dst) T(from);
+                } else {
+                    *static_cast<T**>(dst) = new T(from);
+                }
+            },
+            [](void* dst, void* src) {
+                if constexpr (fitsInline<T>) {
+                    T& from = *static_cast<T*>(src);
+                    new (dst) T(std::move(from));
+                    from.~T();
+                } else {
+                    *static_cast<T**>(dst) = *static_cast<T**>(src);
+                }
+            },
+            [](void* s) {
+                if constexpr (fitsInline<T>) {
+                    static_cast<T*>(s)->~T();
+                } else {
+                    delete *static_cast<T**>(s);
+                }
+            },
+        };
+        return &table;
+    }
+
+    template <typename T, typename Arg>
+    void emplace(Arg&& arg)
+    {
+        if constexpr (fitsInline<T>) {
+            new (storage) T(std::forward<Arg>(arg));
+        } else {
+            *reinterpret_cast<T**>(storage) = new T(std::forward<Arg>(arg));
+        }
+        ops = opsFor<T>();
+    }
+
+    void reset()
+    {
+        if (ops != nullptr) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[InlineSize];
+    const Ops* ops = nullptr;
+};
+
+// History: fixed-capacity ring of inline command copies. Once full,
+// the oldest entry is dropped. Undo and redo are O(1) and never
+// allocate.
+template <size_t Capacity, size_t SlotSize = 48>
+class CommandHistory {
+private:
+    struct Slot {
+        alignas(std::max_align_t) unsigned char storage[SlotSize];
+        Command* command = nullptr;
+    };
+
+    Slot slots[Capacity];
+    size_t head = 0;   // oldest entry
+    size_t count = 0;  // entries in the ring
+    size_t cursor = 0; // entries currently applied; [cursor, count) is redo
+
+    Slot& at(size_t offset) { return slots[(head + offset) % Capacity]; }
+
+    void destroy(Slot& slot)
+    {
+        slot.command->~Command();
+        slot.command = nullptr;
+    }
+
+public:
+    CommandHistory() = default;
+    CommandHistory(const CommandHistory&) = delete;
+    CommandHistory& operator=(const CommandHistory&) = delete;
+
+    ~CommandHistory()
+    {
+        for (size_t i = 0; i < count; ++i) {
+            destroy(at(i));
+        }
+    }
+
+    // Executes a copy of the command and records it, discarding
+    // anything that could still be redone.
+    void record(const Command& command)
+    {
+        while (count > cursor) {
+            destroy(at(--count));
+        }
+        if (count == Capacity) {
+            destroy(at(0));
+            head = (head + 1) % Capacity;
+            --count;
+            --cursor;
+        }
+        Slot& slot = at(cursor);
+        slot.command = command.cloneInto(slot.storage, SlotSize);
+        slot.command->execute();
+        count = ++cursor;
+    }
+
+    bool undo()
+    {
+        if (cursor == 0) {
+            return false;
+        }
+        at(--cursor).command->undo();
+        return true;
+    }
+
+    bool redo()
+    {
+        if (cursor == count) {
+            return false;
+        }
+        at(cursor++).command->execute();
+        return true;
+    }
 };
 
 // Invoker
 class Invoker {
 private:
-    Command* command;
+    CommandFn command;
+    CommandHistory<32> history;
 
 public:
     // The setCommand method allows setting the command to
-    // be executed.
-    void setCommand(Command* cmd) { command = cmd; }
+    // be executed: a Command*, a Command by value or a callable.
+    void setCommand(CommandFn cmd) { command = std::move(cmd); }
 
     // The executeCommand method triggers the execution of
-    // the command.
-    void executeCommand() { command->execute(); }
+    // the command. Only Command objects can be undone.
+    void executeCommand()
+    {
+        if (Command* cmd = command.command()) {
+            history.record(*cmd);
+        } else {
+            command();
+        }
+    }
+
+    // The undoCommand/redoCommand methods walk the history.
+    void undoCommand() { history.undo(); }
+    void redoCommand() { history.redo(); }
 };
 
 int main(int argc, char *argv[])
@@ -70,5 +361,13 @@ int main(int argc, char *argv[])
     // Execute the command.
     invoker.executeCommand();
 
+    // Undo it, then redo it.
+    invoker.undoCommand();
+    invoker.redoCommand();
+
+    // The invoker can also own its command, stored inline.
+    invoker.setCommand([&receiver] { receiver.performAction(); });
+    invoker.executeCommand();
+
     return a.exec();
 }
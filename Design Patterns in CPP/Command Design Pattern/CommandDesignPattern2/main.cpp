@@ -1,39 +1,104 @@
 #include <QCoreApplication>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 // Receiver: Electronic Device
 class ElectronicDevice {
 private:
     std::string name;
+    bool verbose;
+    bool on = false;
+    std::mutex access;
 
 public:
-    ElectronicDevice(const std::string & n)
-        : name(n)
+    ElectronicDevice(const std::string & n, bool verbose = true)
+        : name(n), verbose(verbose)
     {
     }
 
     void turnOn()
     {
-        std::cout << name << " :: is ON now " << std::endl;
+        on = true;
+        if (verbose) {
+            std::cout << name << " :: is ON now " << std::endl;
+        }
     }
 
     void turnOff()
     {
-        std::cout << name << " :: is OFF now" << std::endl;
+        on = false;
+        if (verbose) {
+            std::cout << name << " :: is OFF now" << std::endl;
+        }
     }
+
+    bool isOn() const { return on; }
+
+    // Sets the state silently; used when replaying a journal.
+    void restoreState(bool isOn) { on = isOn; }
+
+    // Serialises executor threads that reach the same device.
+    std::mutex& mutex() { return access; }
 };
 
 // Command interface
 class Command {
 public:
+    virtual ~Command() = default;
     virtual void execute() = 0;
+
+    // Reverts the effect of the last execute() on this object.
+    virtual void undo() = 0;
+
+    // Copy-constructs this command into caller-provided storage and
+    // returns it. Lets CommandHistory keep commands inline, without heap
+    // allocation.
+    virtual Command* cloneInto(void* storage, size_t capacity) const = 0;
+
+    // Device the command acts on, used by the async executor for
+    // per-device ordering and batching. nullptr if it has none.
+    virtual ElectronicDevice* target() const { return nullptr; }
 };
 
+template <typename T>
+Command* placeClone(const T& command, void* storage, size_t capacity)
+{
+    if (sizeof(T) > capacity) {
+        throw std::length_error("Command does not fit in history slot");
+    }
+    return new (storage) T(command);
+}
+
 // Concrete Command: Turn on
 class TurnOnCommand : public Command {
 private:
     ElectronicDevice& device;
+    bool wasOn = false;
 
 public:
     TurnOnCommand(ElectronicDevice& dev)
@@ -41,13 +106,32 @@ public:
     {
     }
 
-    void execute() { device.turnOn(); }
+    void execute()
+    {
+        wasOn = device.isOn();
+        device.turnOn();
+    }
+
+    void undo() override
+    {
+        if (!wasOn) {
+            device.turnOff();
+        }
+    }
+
+    Command* cloneInto(void* storage, size_t capacity) const override
+    {
+        return placeClone(*this, storage, capacity);
+    }
+
+    ElectronicDevice* target() const override { return &device; }
 };
 
 // Concrete Command: Turn off
 class TurnOffCommand : public Command {
 private:
     ElectronicDevice& device;
+    bool wasOn = false;
 
 public:
     TurnOffCommand(ElectronicDevice&dev)
@@ -55,26 +139,982 @@ public:
     {
     }
 
-    void execute() { device.turnOff(); }
+    void execute()
+    {
+        wasOn = device.isOn();
+        device.turnOff();
+    }
+
+    void undo() override
+    {
+        if (wasOn) {
+            device.turnOn();
+        }
+    }
+
+    Command* cloneInto(void* storage, size_t capacity) const override
+    {
+        return placeClone(*this, storage, capacity);
+    }
+
+    ElectronicDevice* target() const override { return &device; }
+};
+
+// CommandFn: owning, type-erased command value. Anything up to
+// InlineSize bytes (a concrete command, a small lambda) is stored inside
+// the CommandFn itself, larger objects go to the heap. Calls go through
+// a static table of function pointers, one per stored type.
+class CommandFn {
+public:
+    static constexpr size_t InlineSize = 48;
+
+    CommandFn() = default;
+
+    // Non-owning: forwards to a Command the caller keeps alive.
+    CommandFn(Command* command) { emplace<Borrowed>(Borrowed{command}); }
+
+    // Owning: commands run execute(), any other callable runs operator().
+    template <typename F,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, CommandFn>
+                                          && !std::is_pointer_v<std::decay_t<F>>>>
+    CommandFn(F&& f)
+    {
+        emplace<std::decay_t<F>>(std::forward<F>(f));
+    }
+
+    CommandFn(const CommandFn& other)
+    {
+        if (other.ops != nullptr) {
+            other.ops->copy(storage, other.storage);
+            ops = other.ops;
+        }
+    }
+
+    CommandFn(CommandFn&& other) noexcept
+    {
+        if (other.ops != nullptr) {
+            other.ops->move(storage, other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    CommandFn& operator=(CommandFn other) noexcept
+    {
+        reset();
+        if (other.ops != nullptr) {
+            other.ops->move(storage, other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+        return *this;
+    }
+
+    ~CommandFn() { reset(); }
+
+    void operator()() { ops->invoke(storage); }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    // The wrapped Command, or nullptr for plain callables.
+    Command* command() { return ops != nullptr ? ops->command(storage) : nullptr; }
+
+private:
+    struct Borrowed {
+        Command* command;
+    };
+
+    struct Ops {
+        void (*invoke)(void*);
+        Command* (*command)(void*);
+        void (*copy)(void* dst, const void* src);
+        void (*move)(void* dst, void* src); // move-constructs dst, destroys src
+        void (*destroy)(void*);
+    };
+
+    template <typename T>
+    static constexpr bool fitsInline = sizeof(T) <= InlineSize
+        && alignof(T) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<T>;
+
+    template <typename T>
+    static void call(T& target)
+    {
+        if constexpr (std::is_same_v<T, Borrowed>) {
+            target.command->execute();
+        } else if constexpr (std::is_base_of_v<Command, T>) {
+            target.T::execute(); // type is known: skip the virtual call
+        } else {
+            target();
+        }
+    }
+
+    template <typename T>
+    static Command* commandOf(T& target)
+    {
+        if constexpr (std::is_same_v<T, Borrowed>) {
+            return target.command;
+        } else if constexpr (std::is_base_of_v<Command, T>) {
+            return &target;
+        } else {
+            return nullptr;
+        }
+    }
+
+    template <typename T>
+    static T& object(void* storage)
+    {
+        if constexpr (fitsInline<T>) {
+            return *static_cast<T*>(storage);
+        } else {
+            return **static_cast<T**>(storage);
+        }
+    }
+
+    template <typename T>
+    static const Ops* opsFor()
+    {
+        static const Ops table = {
+            [](void* s) { call(object<T>(s)); },
+            [](void* s) { return commandOf(object<T>(s)); },
+            [](void* dst, const void* src) {
+                const T& from = object<T>(const_cast<void*>(src));
+                if constexpr (fitsInline<T>) {
+                    new (dst) T(from);
+                } else {
+                    *static_cast<T**>(dst) = new T(from);
+                }
+            },
+            [](void* dst, void* src) {
+                if constexpr (fitsInline<T>) {
+                    T& from = *static_cast<T*>(src);
+                    new (dst) T(std::move(from));
+                    from.~T();
+                } else {
+                    *static_cast<T**>(dst) = *static_cast<T**>(src);
+                }
+            },
+            [](void* s) {
+                if constexpr (fitsInline<T>) {
+                    static_cast<T*>(s)->~T();
+                } else {
+                    delete *static_cast<T**>(s);
+                }
+            },
+        };
+        return &table;
+    }
+
+    template <typename T, typename Arg>
+    void emplace(Arg&& arg)
+    {
+        if constexpr (fitsInline<T>) {
+            new (storage) T(std::forward<Arg>(arg));
+        } else {
+            *reinterpret_cast<T**>(storage) = new T(std::forward<Arg>(arg));
+        }
+        ops = opsFor<T>();
+    }
+
+    void reset()
+    {
+        if (ops != nullptr) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[InlineSize];
+    const Ops* ops = nullptr;
+};
+
+// Bounded undo/redo history. Executed commands are copied into a
+// fixed ring of inline slots; when the ring is full the oldest entry is
+// dropped. record/undo/redo never allocate.
+template <size_t Capacity, size_t SlotSize = 48>
+class CommandHistory {
+private:
+    struct Slot {
+        alignas(std::max_align_t) unsigned char storage[SlotSize];
+        Command* command = nullptr;
+    };
+
+    Slot slots[Capacity];
+    size_t head = 0;   // oldest entry
+    size_t count = 0;  // entries in the ring
+    size_t cursor = 0; // entries currently applied; [cursor, count) is redo
+
+    Slot& at(size_t offset) { return slots[(head + offset) % Capacity]; }
+
+    void destroy(Slot& slot)
+    {
+        slot.command->~Command();
+        slot.command = nullptr;
+    }
+
+public:
+    CommandHistory() = default;
+    CommandHistory(const CommandHistory&) = delete;
+    CommandHistory& operator=(const CommandHistory&) = delete;
+
+    ~CommandHistory()
+    {
+        for (size_t i = 0; i < count; ++i) {
+            destroy(at(i));
+        }
+    }
+
+    // Executes a copy of the command and records it. Discards the redo
+    // branch, like any editor would.
+    void record(const Command& command)
+    {
+        while (count > cursor) {
+            destroy(at(--count));
+        }
+        if (count == Capacity) {
+            destroy(at(0));
+            head = (head + 1) % Capacity;
+            --count;
+            --cursor;
+        }
+        Slot& slot = at(cursor);
+        slot.command = command.cloneInto(slot.storage, SlotSize);
+        slot.command->execute();
+        count = ++cursor;
+    }
+
+    // Returns the command that was undone, or nullptr.
+    Command* undo()
+    {
+        if (cursor == 0) {
+            return nullptr;
+        }
+        Command* command = at(--cursor).command;
+        command->undo();
+        return command;
+    }
+
+    // Returns the command that was re-executed, or nullptr.
+    Command* redo()
+    {
+        if (cursor == count) {
+            return nullptr;
+        }
+        Command* command = at(cursor++).command;
+        command->execute();
+        return command;
+    }
+
+    size_t undoDepth() const { return cursor; }
+    size_t redoDepth() const { return count - cursor; }
+};
+
+// Lock-free multi-producer/single-consumer queue (Vyukov). Producers
+// publish with a single atomic exchange; only the consumer walks the list.
+template <typename T>
+class MpscQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    alignas(64) std::atomic<Node*> head;
+    alignas(64) Node* tail;
+    Node stub;
+
+public:
+    MpscQueue()
+        : head(&stub), tail(&stub)
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T ignored;
+        while (pop(ignored)) {
+        }
+        if (tail != &stub) {
+            delete tail;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value)
+    {
+        Node* node = new Node;
+        node->value = std::move(value);
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer only. May briefly report empty while a producer is between
+    // its exchange and its link store; the item shows up on the next call.
+    bool pop(T& out)
+    {
+        Node* first = tail;
+        Node* next = first->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        out = std::move(next->value);
+        tail = next;
+        if (first != &stub) {
+            delete first;
+        }
+        return true;
+    }
+};
+
+// Latency histogram: each power of two is split into 8 linear
+// sub-buckets, so a percentile is exact to within 1/8 of its value.
+// Recording is wait-free.
+class LatencyHistogram {
+private:
+    static constexpr int SubBuckets = 8;
+    static constexpr int Buckets = 64 * SubBuckets;
+    std::atomic<uint64_t> counts[Buckets] = {};
+
+    // Values below SubBuckets get a bucket each; above that, the top bit
+    // picks the power of two and the next three bits the sub-bucket.
+    static int bucketOf(uint64_t value)
+    {
+        if (value < SubBuckets) {
+            return static_cast<int>(value);
+        }
+        int top = 3;
+        while (top < 63 && (value >> (top + 1)) != 0) {
+            ++top;
+        }
+        int shift = top - 3;
+        return (shift + 1) * SubBuckets + static_cast<int>((value >> shift) & (SubBuckets - 1));
+    }
+
+    static uint64_t upperBound(int bucket)
+    {
+        if (bucket < SubBuckets) {
+            return static_cast<uint64_t>(bucket);
+        }
+        int shift = bucket / SubBuckets - 1;
+        uint64_t mantissa = static_cast<uint64_t>(bucket % SubBuckets + SubBuckets);
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t nanos)
+    {
+        counts[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t total() const
+    {
+        uint64_t sum = 0;
+        for (const auto& c : counts) {
+            sum += c.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    // Upper bound (in ns) of the bucket holding the given percentile.
+    uint64_t percentile(double p) const
+    {
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * total());
+        uint64_t seen = 0;
+        for (int i = 0; i < Buckets; ++i) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen > rank) {
+                return upperBound(i);
+            }
+        }
+        return 0;
+    }
+};
+
+// Crash-recovery journal. Every executed command appends one 8-byte
+// record (device id, resulting state) to a memory-mapped segment file.
+// Segments are preallocated and zero-filled, so the first all-zero record
+// marks the end of the log. Records are flushed in groups: one msync per
+// groupCommit appends, or on sync(). append() may be called from several
+// executor threads at once.
+class CommandJournal {
+public:
+    enum Op : uint32_t { End = 0, TurnOn = 1, TurnOff = 2 };
+
+    struct Record {
+        uint32_t device;
+        uint32_t op;
+    };
+
+    CommandJournal(const std::string& directory, std::vector<ElectronicDevice*> devices,
+                   size_t segmentBytes = size_t(64) << 20, size_t groupCommit = 65536)
+        : directory(directory),
+          devices(std::move(devices)),
+          segmentBytes(segmentBytes - segmentBytes % sizeof(Record)),
+          groupCommit(groupCommit),
+          pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE)))
+    {
+        std::filesystem::create_directories(directory);
+        for (size_t i = 0; i < this->devices.size(); ++i) {
+            ids[this->devices[i]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    ~CommandJournal()
+    {
+        if (mapped != nullptr) {
+            sync();
+            closeSegment();
+        }
+    }
+
+    CommandJournal(const CommandJournal&) = delete;
+    CommandJournal& operator=(const CommandJournal&) = delete;
+
+    // Rebuilds device state from the snapshot (if one exists) and every
+    // record after it, then opens the log for appending. Must be called
+    // before append(). Returns the number of records replayed.
+    uint64_t recover()
+    {
+        uint32_t segment = 0;
+        size_t offset = 0;
+        loadSnapshot(segment, offset);
+
+        uint64_t replayed = 0;
+        while (std::filesystem::exists(segmentPath(segment))) {
+            size_t end = replaySegment(segment, offset, replayed);
+            if (!std::filesystem::exists(segmentPath(segment + 1))) {
+                offset = end;
+                break;
+            }
+            ++segment;
+            offset = 0;
+        }
+        openSegment(segment, offset);
+        // A torn msync can leave records from before the crash past the
+        // end marker. Clear them, or a shorter run of new records could
+        // end in front of them and the next replay would apply them.
+        clearTail();
+        recovered = true;
+        return replayed;
+    }
+
+    // True if append(device) will succeed. Lets callers reject a command
+    // before handing it to an executor thread.
+    bool accepts(const ElectronicDevice& device) const
+    {
+        return recovered && ids.count(&device) != 0;
+    }
+
+    // Logs the current state of the device.
+    void append(const ElectronicDevice& device)
+    {
+        auto it = ids.find(&device);
+        if (it == ids.end()) {
+            throw std::invalid_argument("Device is not registered with the journal");
+        }
+        std::lock_guard<std::mutex> lock(appendMutex);
+        if (mapped == nullptr) {
+            throw std::logic_error("CommandJournal::recover() must be called before append()");
+        }
+        if (writeOffset + sizeof(Record) > segmentBytes) {
+            syncLocked();
+            closeSegment();
+            openSegment(currentSegment + 1, 0);
+        }
+        Record record{it->second, device.isOn() ? TurnOn : TurnOff};
+        std::memcpy(mapped + writeOffset, &record, sizeof(Record));
+        writeOffset += sizeof(Record);
+        if (++unsynced >= groupCommit) {
+            syncLocked();
+        }
+    }
+
+    // Group commit: flushes every record appended since the last sync.
+    void sync()
+    {
+        std::lock_guard<std::mutex> lock(appendMutex);
+        syncLocked();
+    }
+
+    // Writes all device states plus the current log position, then drops
+    // segments the snapshot fully covers. Later recoveries start here.
+    // The snapshot is fsynced and renamed into place, and the rename is
+    // made durable, before any segment is removed.
+    void writeSnapshot()
+    {
+        std::lock_guard<std::mutex> lock(appendMutex);
+        syncLocked();
+        std::string tmp = directory + "/snapshot.tmp";
+        std::vector<char> image(sizeof(uint64_t) * 3 + devices.size());
+        uint64_t header[3] = {currentSegment, writeOffset, devices.size()};
+        std::memcpy(image.data(), header, sizeof(header));
+        for (size_t i = 0; i < devices.size(); ++i) {
+            image[sizeof(header) + i] = devices[i]->isOn() ? 1 : 0;
+        }
+
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create journal snapshot");
+        }
+        bool written = writeAll(fd, image.data(), image.size()) && fsync(fd) == 0;
+        ::close(fd);
+        if (!written) {
+            throw std::runtime_error("Failed to write journal snapshot");
+        }
+        if (std::rename(tmp.c_str(), (directory + "/snapshot.bin").c_str()) != 0) {
+            throw std::runtime_error("Failed to install journal snapshot");
+        }
+        syncDirectory();
+        for (uint32_t segment = 0; segment < currentSegment; ++segment) {
+            std::filesystem::remove(segmentPath(segment));
+        }
+    }
+
+private:
+    void syncLocked()
+    {
+        if (unsynced == 0) {
+            return;
+        }
+        size_t begin = syncedOffset - syncedOffset % pageSize;
+        if (msync(mapped + begin, writeOffset - begin, MS_SYNC) != 0) {
+            throw std::runtime_error("msync failed on command journal");
+        }
+        syncedOffset = writeOffset;
+        unsynced = 0;
+    }
+
+    static bool writeAll(int fd, const char* data, size_t size)
+    {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Makes the snapshot rename itself survive a crash.
+    void syncDirectory() const
+    {
+        int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open journal directory");
+        }
+        int result = fsync(fd);
+        ::close(fd);
+        if (result != 0) {
+            throw std::runtime_error("fsync failed on journal directory");
+        }
+    }
+
+    std::string segmentPath(uint32_t segment) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/segment-%08u.log", segment);
+        return directory + name;
+    }
+
+    void loadSnapshot(uint32_t& segment, size_t& offset)
+    {
+        std::ifstream in(directory + "/snapshot.bin", std::ios::binary);
+        if (!in.is_open()) {
+            return; // no snapshot yet: replay from the first segment
+        }
+        uint64_t header[3];
+        if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            throw std::runtime_error("Journal snapshot header is truncated");
+        }
+        if (header[2] != devices.size()) {
+            throw std::runtime_error("Journal snapshot does not match the device list");
+        }
+        std::vector<char> states(devices.size());
+        if (!in.read(states.data(), static_cast<std::streamsize>(states.size()))) {
+            throw std::runtime_error("Journal snapshot device states are truncated");
+        }
+        for (size_t i = 0; i < devices.size(); ++i) {
+            devices[i]->restoreState(states[i] != 0);
+        }
+        segment = static_cast<uint32_t>(header[0]);
+        offset = static_cast<size_t>(header[1]);
+    }
+
+    // Applies records from offset to the end marker; returns the end offset.
+    size_t replaySegment(uint32_t segment, size_t offset, uint64_t& replayed)
+    {
+        int fd = ::open(segmentPath(segment).c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open journal segment");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat journal segment");
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        if (size == 0) {
+            ::close(fd);
+            return 0;
+        }
+        void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map journal segment");
+        }
+        madvise(data, size, MADV_SEQUENTIAL);
+
+        const Record* records = static_cast<const Record*>(data);
+        size_t count = size / sizeof(Record);
+        size_t i = offset / sizeof(Record);
+        for (; i < count && records[i].op != End; ++i) {
+            if (records[i].device < devices.size()) {
+                devices[records[i].device]->restoreState(records[i].op == TurnOn);
+            }
+        }
+        replayed += i - offset / sizeof(Record);
+        munmap(data, size);
+        return i * sizeof(Record);
+    }
+
+    void openSegment(uint32_t segment, size_t offset)
+    {
+        int fd = ::open(segmentPath(segment).c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(segmentBytes)) != 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Cannot create journal segment");
+        }
+        void* data = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map journal segment");
+        }
+        mapped = static_cast<char*>(data);
+        currentSegment = segment;
+        writeOffset = offset;
+        syncedOffset = offset;
+    }
+
+    // Zeroes the mapped segment from writeOffset to its end, durably.
+    // Whole pages are punched out of the file where that is supported.
+    void clearTail()
+    {
+        size_t pageEnd = std::min(segmentBytes, (writeOffset + pageSize - 1) / pageSize * pageSize);
+        std::memset(mapped + writeOffset, 0, pageEnd - writeOffset);
+        int fd = ::open(segmentPath(currentSegment).c_str(), O_RDWR);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open journal segment");
+        }
+        bool punched = pageEnd == segmentBytes
+            || fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                         static_cast<off_t>(pageEnd), static_cast<off_t>(segmentBytes - pageEnd))
+                == 0;
+        if (!punched) {
+            std::memset(mapped + pageEnd, 0, segmentBytes - pageEnd);
+        }
+        size_t begin = writeOffset - writeOffset % pageSize;
+        size_t end = punched ? pageEnd : segmentBytes;
+        int result = end > begin ? msync(mapped + begin, end - begin, MS_SYNC) : 0;
+        result = result == 0 ? fsync(fd) : result;
+        ::close(fd);
+        if (result != 0) {
+            throw std::runtime_error("Cannot clear journal segment tail");
+        }
+    }
+
+    void closeSegment()
+    {
+        munmap(mapped, segmentBytes);
+        mapped = nullptr;
+    }
+
+    std::string directory;
+    std::vector<ElectronicDevice*> devices;
+    std::unordered_map<const ElectronicDevice*, uint32_t> ids;
+    std::mutex appendMutex;
+    size_t segmentBytes;
+    size_t groupCommit;
+    size_t pageSize;
+
+    bool recovered = false;
+    char* mapped = nullptr;
+    uint32_t currentSegment = 0;
+    size_t writeOffset = 0;
+    size_t syncedOffset = 0;
+    size_t unsynced = 0;
+};
+
+struct ExecutorOptions {
+    unsigned threads = 1;
+    // Commands for one device always go to the same executor, so they
+    // run in submission order (per producer).
+    bool perDeviceOrdering = true;
+    // Consecutive commands for the same device run under one device lock.
+    bool batching = true;
+    // If set, each executed command logs its device's new state while the
+    // device lock is still held, so the log follows execution order.
+    CommandJournal* journal = nullptr;
+};
+
+// Executes submitted commands on background threads. Each executor thread
+// owns one MPSC queue, so producers never block on each other or on a slow
+// device.
+class AsyncCommandExecutor {
+private:
+    struct Job {
+        Command* command = nullptr;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct Shard {
+        MpscQueue<Job> queue;
+        std::atomic<bool> sleeping{false};
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        bool signalled = false; // guarded by wakeMutex
+        std::thread thread;
+    };
+
+    ExecutorOptions options;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> roundRobin{0};
+    std::atomic<int64_t> depth{0};
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> batches{0};
+    LatencyHistogram latency;
+
+public:
+    explicit AsyncCommandExecutor(const ExecutorOptions& opts)
+        : options(opts)
+    {
+        unsigned count = options.threads == 0 ? 1 : options.threads;
+        for (unsigned i = 0; i < count; ++i) {
+            shards.push_back(std::make_unique<Shard>());
+        }
+        for (auto& shard : shards) {
+            Shard* s = shard.get();
+            s->thread = std::thread([this, s] { run(*s); });
+        }
+    }
+
+    ~AsyncCommandExecutor()
+    {
+        drain();
+        stopping.store(true);
+        for (auto& shard : shards) {
+            {
+                std::lock_guard<std::mutex> lock(shard->wakeMutex);
+            }
+            shard->wake.notify_one();
+            shard->thread.join();
+        }
+    }
+
+    void submit(Command* command)
+    {
+        Shard& shard = pickShard(command);
+        depth.fetch_add(1, std::memory_order_relaxed);
+        shard.queue.push(Job{command, std::chrono::steady_clock::now()});
+        // Pairs with the fence in run(): either the executor's re-check
+        // sees this job or we see it sleeping and wake it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard.sleeping.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(shard.wakeMutex);
+            shard.signalled = true;
+            shard.wake.notify_one();
+        }
+    }
+
+    // Blocks until every submitted command has executed.
+    void drain() const
+    {
+        while (depth.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    int64_t queueDepth() const { return depth.load(std::memory_order_relaxed); }
+    uint64_t executedCount() const { return executed.load(std::memory_order_relaxed); }
+    uint64_t batchCount() const { return batches.load(std::memory_order_relaxed); }
+    const LatencyHistogram& latencyHistogram() const { return latency; }
+
+private:
+    Shard& pickShard(Command* command)
+    {
+        size_t index;
+        if (options.perDeviceOrdering) {
+            index = std::hash<ElectronicDevice*>()(command->target());
+        } else {
+            index = roundRobin.fetch_add(1, std::memory_order_relaxed);
+        }
+        return *shards[index % shards.size()];
+    }
+
+    void run(Shard& shard)
+    {
+        std::vector<Job> batch;
+        Job job;
+        for (;;) {
+            while (batch.size() < 256 && shard.queue.pop(job)) {
+                batch.push_back(job);
+            }
+            if (batch.empty()) {
+                if (stopping.load()) {
+                    return;
+                }
+                std::unique_lock<std::mutex> lock(shard.wakeMutex);
+                shard.signalled = false;
+                shard.sleeping.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // Re-check after announcing we sleep: a producer that
+                // linked its job before seeing `sleeping` did not notify.
+                // One that links later sees it and sets `signalled`.
+                if (shard.queue.pop(job)) {
+                    batch.push_back(job);
+                } else {
+                    shard.wake.wait(lock, [&] { return shard.signalled || stopping.load(); });
+                }
+                shard.sleeping.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            execute(batch);
+            batch.clear();
+        }
+    }
+
+    void execute(const std::vector<Job>& batch)
+    {
+        size_t i = 0;
+        while (i < batch.size()) {
+            ElectronicDevice* device = batch[i].command->target();
+            size_t end = i + 1;
+            if (options.batching) {
+                while (end < batch.size() && batch[end].command->target() == device) {
+                    ++end;
+                }
+            }
+            size_t count = end - i;
+            std::unique_lock<std::mutex> lock;
+            if (device != nullptr) {
+                lock = std::unique_lock<std::mutex>(device->mutex());
+            }
+            for (; i < end; ++i) {
+                batch[i].command->execute();
+                if (options.journal != nullptr && device != nullptr) {
+                    options.journal->append(*device);
+                }
+                auto waited = std::chrono::steady_clock::now() - batch[i].enqueued;
+                latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+            }
+            executed.fetch_add(count, std::memory_order_relaxed);
+            batches.fetch_add(1, std::memory_order_relaxed);
+            depth.fetch_sub(static_cast<int64_t>(count), std::memory_order_release);
+        }
+    }
 };
 
 // Invoker: Remote Control
 class RemoteControl {
 private:
-    std::vector <Command*> commands;
+    // Stored contiguously. Queued async jobs point into this vector, so
+    // do not add commands while an executor is running.
+    std::vector <CommandFn> commands;
+    std::unique_ptr<AsyncCommandExecutor> executor;
+    CommandHistory<64> history;
+    CommandJournal* journal = nullptr;
+
+    void journalTarget(const Command* command)
+    {
+        if (journal != nullptr && command != nullptr && command->target() != nullptr) {
+            journal->append(*command->target());
+        }
+    }
 
 public:
-    void addCommand(Command* cmd)
+    // Takes a Command* (kept alive by the caller), a Command by value or
+    // any callable.
+    void addCommand(CommandFn cmd)
     {
-        commands.push_back(cmd);
+        commands.push_back(std::move(cmd));
     }
 
     void pressButton(int slot)
     {
         if (slot >= 0 && slot < commands.size()) {
-            commands[slot]->execute();
+            Command* command = commands[slot].command();
+            if (command == nullptr) {
+                commands[slot](); // plain callable: no undo, no journal
+                return;
+            }
+            history.record(*command);
+            journalTarget(command);
+        }
+    }
+
+    // Every press, undo and redo is logged to the journal, if one is set.
+    // Set it before startExecutor() so async commands are logged too.
+    void setJournal(CommandJournal* j) { journal = j; }
+
+    // Undo/redo cover pressButton() only; submit() is fire-and-forget but
+    // still journaled, by the executor thread that runs the command.
+    bool undo()
+    {
+        Command* command = history.undo();
+        journalTarget(command);
+        return command != nullptr;
+    }
+
+    bool redo()
+    {
+        Command* command = history.redo();
+        journalTarget(command);
+        return command != nullptr;
+    }
+
+    // Switches the remote to asynchronous mode; submit() then queues
+    // commands for the executor threads instead of running them inline.
+    void startExecutor(const ExecutorOptions& options = ExecutorOptions())
+    {
+        ExecutorOptions withJournal = options;
+        if (withJournal.journal == nullptr) {
+            withJournal.journal = journal;
         }
+        executor = std::make_unique<AsyncCommandExecutor>(withJournal);
     }
+
+    // Waits for queued commands, then returns to synchronous mode.
+    void stopExecutor() { executor.reset(); }
+
+    void submit(int slot)
+    {
+        if (slot < 0 || static_cast<size_t>(slot) >= commands.size()) {
+            return;
+        }
+        Command* command = commands[slot].command();
+        if (executor && command != nullptr) {
+            // Fail here rather than on the executor thread.
+            if (journal != nullptr && command->target() != nullptr
+                && !journal->accepts(*command->target())) {
+                throw std::invalid_argument("Command target cannot be journaled");
+            }
+            executor->submit(command);
+        } else {
+            commands[slot]();
+            journalTarget(command);
+        }
+    }
+
+    const AsyncCommandExecutor* asyncExecutor() const { return executor.get(); }
 };
 
 int main(int argc, char *argv[])
@@ -106,5 +1146,201 @@ int main(int argc, char *argv[])
     remote.pressButton(1); // Turn off TV
     remote.pressButton(2); // Turn on Lights
 
+    // Undo the last two presses, then redo one
+    remote.undo(); // Lights back OFF
+    remote.undo(); // TV back ON
+    remote.redo(); // TV OFF again
+
+    // 10M execute/undo cycles through the bounded history.
+    ElectronicDevice lamp("Lamp", false);
+    TurnOnCommand turnOnLamp(lamp);
+    TurnOffCommand turnOffLamp(lamp);
+    RemoteControl lampRemote;
+    lampRemote.addCommand(&turnOnLamp);
+    lampRemote.addCommand(&turnOffLamp);
+
+    const int cycles = 10000000;
+    auto cycleStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < cycles; ++i) {
+        // Net one entry per cycle, so the ring wraps every 64 cycles.
+        lampRemote.pressButton(i & 1);
+        lampRemote.pressButton(~i & 1);
+        lampRemote.undo();
+    }
+    auto cycleTime = std::chrono::steady_clock::now() - cycleStart;
+    std::cout << cycles << " execute/undo cycles: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(cycleTime).count()
+              << " ms, lamp is " << (lamp.isOn() ? "ON" : "OFF") << std::endl;
+
+    // Buttons held by value: an owned command and a lambda.
+    RemoteControl valueRemote;
+    valueRemote.addCommand(TurnOnCommand(tv));
+    valueRemote.addCommand([&lights] { lights.turnOff(); });
+    valueRemote.pressButton(0);
+    valueRemote.pressButton(1);
+
+    // Construction and dispatch: Command* vs std::function vs CommandFn.
+    {
+        ElectronicDevice bench("Bench", false);
+        const int n = 1000000;
+        // Dispatch runs over a cache-resident prefix, so it measures the
+        // call path rather than memory bandwidth.
+        const int hot = 1024;
+        const int passes = 20000;
+        using Clock = std::chrono::steady_clock;
+        auto ms = [](Clock::duration d) {
+            return std::chrono::duration<double, std::milli>(d).count();
+        };
+
+        auto t0 = Clock::now();
+        std::vector<std::unique_ptr<Command>> owned;
+        std::vector<Command*> pointers;
+        owned.reserve(n);
+        pointers.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            owned.push_back(std::make_unique<TurnOnCommand>(bench));
+            pointers.push_back(owned.back().get());
+        }
+        auto t1 = Clock::now();
+        std::vector<std::function<void()>> functions;
+        functions.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            functions.emplace_back([cmd = TurnOnCommand(bench)]() mutable { cmd.execute(); });
+        }
+        auto t2 = Clock::now();
+        std::vector<CommandFn> values;
+        values.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            values.emplace_back(TurnOnCommand(bench));
+        }
+        auto t3 = Clock::now();
+
+        for (int p = 0; p < passes; ++p) {
+            for (int i = 0; i < hot; ++i) {
+                pointers[i]->execute();
+            }
+        }
+        auto t4 = Clock::now();
+        for (int p = 0; p < passes; ++p) {
+            for (int i = 0; i < hot; ++i) {
+                functions[i]();
+            }
+        }
+        auto t5 = Clock::now();
+        for (int p = 0; p < passes; ++p) {
+            for (int i = 0; i < hot; ++i) {
+                values[i]();
+            }
+        }
+        auto t6 = Clock::now();
+
+        std::cout << "Build 1M (ms): Command* " << ms(t1 - t0) << ", std::function "
+                  << ms(t2 - t1) << ", CommandFn " << ms(t3 - t2) << std::endl;
+        std::cout << "Dispatch 20M (ms): Command* " << ms(t4 - t3) << ", std::function "
+                  << ms(t5 - t4) << ", CommandFn " << ms(t6 - t5) << std::endl;
+    }
+
+    // Journaled remote: device state survives a restart.
+    std::string journalDir
+        = (std::filesystem::temp_directory_path() / "command-journal").string();
+    std::filesystem::remove_all(journalDir);
+    {
+        ElectronicDevice door("Door", false);
+        ElectronicDevice alarm("Alarm", false);
+        TurnOnCommand openDoor(door);
+        TurnOffCommand closeDoor(door);
+        TurnOnCommand armAlarm(alarm);
+        CommandJournal journal(journalDir, {&door, &alarm});
+        journal.recover();
+
+        RemoteControl journaled;
+        journaled.setJournal(&journal);
+        journaled.addCommand(&openDoor);
+        journaled.addCommand(&closeDoor);
+        journaled.addCommand(&armAlarm);
+
+        const int appends = 5000000;
+        auto appendStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < appends; ++i) {
+            journaled.pressButton(i & 1);
+        }
+        auto appendTime = std::chrono::steady_clock::now() - appendStart;
+
+        // Async submits are journaled by the executor thread.
+        journaled.startExecutor();
+        for (int i = 0; i < 100000; ++i) {
+            journaled.submit(i & 1);
+        }
+        journaled.submit(0); // leave the door open
+        journaled.submit(2); // and the alarm armed
+        journaled.stopExecutor();
+        journal.sync();
+        std::cout << "Journaled " << appends << " presses at "
+                  << static_cast<uint64_t>(appends / std::chrono::duration<double>(appendTime).count())
+                  << " appends/sec" << std::endl;
+    }
+    {
+        // "Restart": fresh devices, state rebuilt from the log.
+        ElectronicDevice door("Door", false);
+        ElectronicDevice alarm("Alarm", false);
+        CommandJournal journal(journalDir, {&door, &alarm});
+        auto replayStart = std::chrono::steady_clock::now();
+        uint64_t replayed = journal.recover();
+        auto replayTime = std::chrono::steady_clock::now() - replayStart;
+        std::cout << "Replayed " << replayed << " records in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(replayTime).count()
+                  << " ms: door is " << (door.isOn() ? "open" : "closed")
+                  << ", alarm is " << (alarm.isOn() ? "armed" : "off") << std::endl;
+        journal.writeSnapshot();
+    }
+    std::filesystem::remove_all(journalDir);
+
+    // Asynchronous mode: many producer threads submit to the executors.
+    ElectronicDevice fan("Fan", false);
+    ElectronicDevice heater("Heater", false);
+    TurnOnCommand turnOnFan(fan);
+    TurnOffCommand turnOffFan(fan);
+    TurnOnCommand turnOnHeater(heater);
+    TurnOffCommand turnOffHeater(heater);
+
+    RemoteControl busyRemote;
+    busyRemote.addCommand(&turnOnFan);
+    busyRemote.addCommand(&turnOffFan);
+    busyRemote.addCommand(&turnOnHeater);
+    busyRemote.addCommand(&turnOffHeater);
+
+    ExecutorOptions options;
+    options.threads = 2;
+    busyRemote.startExecutor(options);
+
+    const int producers = 4;
+    const int perProducer = 100000;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&busyRemote, p] {
+            for (int i = 0; i < perProducer; ++i) {
+                busyRemote.submit((i + p) % 4);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    const AsyncCommandExecutor& executor = *busyRemote.asyncExecutor();
+    int64_t depthAfterSubmit = executor.queueDepth();
+    executor.drain();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const LatencyHistogram& latency = executor.latencyHistogram();
+    std::cout << "Executed " << executor.executedCount() << " commands in "
+              << executor.batchCount() << " device batches, "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+              << " ms; queue depth after submit: " << depthAfterSubmit << std::endl;
+    std::cout << "Enqueue->execute latency p50 <= " << latency.percentile(50)
+              << " ns, p99 <= " << latency.percentile(99)
+              << " ns, p99.9 <= " << latency.percentile(99.9) << " ns" << std::endl;
+    busyRemote.stopExecutor();
+
     return a.exec();
 }
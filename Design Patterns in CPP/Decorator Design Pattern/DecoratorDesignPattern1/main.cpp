@@ -1,15 +1,87 @@
 #include <QCoreApplication>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <random>
 #include <string>
+#include <string_view>
+#include <vector>
 
 using namespace std;
 
+// Heap allocations so far, for the receipt benchmark.
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Destination for streamed descriptions.
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual void write(const char* text, size_t length) = 0;
+
+    template <size_t N>
+    void write(const char (&text)[N])
+    {
+        write(text, N - 1);
+    }
+};
+
+// Appends to a caller-owned string; allocates only when the
+// string has to grow.
+class StringSink : public Sink {
+public:
+    explicit StringSink(string& out)
+        : out(out)
+    {
+    }
+
+    void write(const char* text, size_t length) override
+    {
+        out.append(text, length);
+    }
+
+private:
+    string& out;
+};
+
 // Component interface - defines the basic ice cream
 // operations.
 class IceCream {
 public:
+    virtual ~IceCream() = default;
     virtual string getDescription() const = 0;
     virtual double cost() const = 0;
+
+    // Streams the description layer by layer, without
+    // building intermediate strings. The default goes
+    // through getDescription().
+    virtual void writeDescription(Sink& sink) const
+    {
+        string description = getDescription();
+        sink.write(description.data(), description.size());
+    }
+
+    void appendDescription(string& out) const
+    {
+        StringSink sink(out);
+        writeDescription(sink);
+    }
 };
 
 // Concrete Component - the basic ice cream class.
@@ -20,10 +92,17 @@ public:
         return "Vanilla Ice Cream";
     }
 
+    void writeDescription(Sink& sink) const override
+    {
+        sink.write("Vanilla Ice Cream");
+    }
+
     double cost() const override { return 160.0; }
 };
 
 // Decorator - abstract class that extends IceCream.
+// Each layer appends topping() to the wrapped description
+// and adds toppingCost() to the wrapped cost.
 class IceCreamDecorator : public IceCream {
 protected:
     IceCream* iceCream;
@@ -36,13 +115,28 @@ public:
 
     string getDescription() const override
     {
-        return iceCream->getDescription();
+        string description = iceCream->getDescription();
+        description += topping();
+        return description;
+    }
+
+    void writeDescription(Sink& sink) const override
+    {
+        iceCream->writeDescription(sink);
+        string_view label = topping();
+        sink.write(label.data(), label.size());
     }
 
     double cost() const override
     {
-        return iceCream->cost();
+        return iceCream->cost() + toppingCost();
     }
+
+    // What this layer adds; also used for flattening.
+    virtual string_view topping() const = 0;
+    virtual double toppingCost() const = 0;
+
+    const IceCream* wrapped() const { return iceCream; }
 };
 
 // Concrete Decorator - adds chocolate topping.
@@ -53,16 +147,11 @@ public:
     {
     }
 
-    string getDescription() const override
-    {
-        return iceCream->getDescription()
-               + " with Chocolate";
-    }
+    static constexpr string_view Label = " with Chocolate";
+    static constexpr double Price = 100.0;
 
-    double cost() const override
-    {
-        return iceCream->cost() + 100.0;
-    }
+    string_view topping() const override { return Label; }
+    double toppingCost() const override { return Price; }
 };
 
 // Concrete Decorator - adds caramel topping.
@@ -73,15 +162,132 @@ public:
     {
     }
 
+    static constexpr string_view Label = " with Caramel";
+    static constexpr double Price = 150.0;
+
+    string_view topping() const override { return Label; }
+    double toppingCost() const override { return Price; }
+};
+
+// Flattened decorator stack: the base ice cream plus a
+// contiguous list of add-ons, innermost first. Cost and
+// description are computed once and cached; push(), pop()
+// and clear() invalidate the cache, and the next query
+// rebuilds it in one pass. Flattening takes a snapshot:
+// later changes go through the stack, not the decorators.
+class IceCreamStack : public IceCream {
+public:
+    struct AddOn {
+        string label;
+        double price;
+    };
+
+    // base must outlive the stack.
+    explicit IceCreamStack(const IceCream* base)
+        : base(base)
+    {
+    }
+
+    // Walks a decorator chain once, outermost to innermost.
+    static IceCreamStack flatten(const IceCream* top)
+    {
+        vector<AddOn> layers;
+        const IceCream* current = top;
+        while (const IceCreamDecorator* decorator
+            = dynamic_cast<const IceCreamDecorator*>(current)) {
+            layers.push_back(
+                AddOn { string(decorator->topping()),
+                    decorator->toppingCost() });
+            current = decorator->wrapped();
+        }
+        IceCreamStack stack(current);
+        stack.addOns.assign(layers.rbegin(), layers.rend());
+        return stack;
+    }
+
+    void push(const string& label, double price)
+    {
+        addOns.push_back(AddOn { label, price });
+        dirty = true;
+    }
+
+    // Adds the topping of a decorator type, e.g.
+    // push<CaramelDecorator>().
+    template <typename Decorator>
+    void push()
+    {
+        push(string(Decorator::Label), Decorator::Price);
+    }
+
+    void pop()
+    {
+        if (!addOns.empty()) {
+            addOns.pop_back();
+            dirty = true;
+        }
+    }
+
+    void clear()
+    {
+        addOns.clear();
+        dirty = true;
+    }
+
+    size_t depth() const { return addOns.size(); }
+
+    const vector<AddOn>& toppings() const { return addOns; }
+
+    // No copy: a reference to the cached string.
+    const string& description() const
+    {
+        rebuild();
+        return cachedDescription;
+    }
+
     string getDescription() const override
     {
-        return iceCream->getDescription() + " with Caramel";
+        return description();
+    }
+
+    void writeDescription(Sink& sink) const override
+    {
+        const string& text = description();
+        sink.write(text.data(), text.size());
     }
 
+    // Summed innermost first, the same order as the
+    // decorators, so the result is identical.
     double cost() const override
     {
-        return iceCream->cost() + 150.0;
+        rebuild();
+        return cachedCost;
     }
+
+private:
+    void rebuild() const
+    {
+        if (!dirty) {
+            return;
+        }
+        cachedDescription = base->getDescription();
+        size_t length = cachedDescription.size();
+        for (const AddOn& addOn : addOns) {
+            length += addOn.label.size();
+        }
+        cachedDescription.reserve(length);
+        cachedCost = base->cost();
+        for (const AddOn& addOn : addOns) {
+            cachedDescription += addOn.label;
+            cachedCost += addOn.price;
+        }
+        dirty = false;
+    }
+
+    const IceCream* base;
+    vector<AddOn> addOns;
+    mutable string cachedDescription;
+    mutable double cachedCost = 0;
+    mutable bool dirty = true;
 };
 
 
@@ -109,9 +315,148 @@ int main(int argc, char *argv[])
          << ", Cost: Rs." << caramelIceCream->cost()
          << endl;
 
+    // Flatten the same order into a stack
+    IceCreamStack stack
+        = IceCreamStack::flatten(caramelIceCream);
+    cout << "Order: " << stack.description()
+         << ", Cost: Rs." << stack.cost() << endl;
+    stack.pop();
+    stack.push<CaramelDecorator>();
+    stack.push<ChocolateDecorator>();
+    cout << "Order: " << stack.description()
+         << ", Cost: Rs." << stack.cost() << endl;
+
     delete vanillaIceCream;
     delete chocolateIceCream;
     delete caramelIceCream;
 
+    // Recursive decorators vs the flattened stack, depth
+    // 1 to 1000: per-call cost() + description, and the
+    // rebuild after a change.
+    VanillaIceCream vanilla;
+    for (size_t depth : { 1, 10, 100, 1000 }) {
+        vector<unique_ptr<IceCream>> layers;
+        const IceCream* top = &vanilla;
+        for (size_t i = 0; i < depth; ++i) {
+            if (i % 2 == 0) {
+                layers.push_back(
+                    make_unique<ChocolateDecorator>(
+                        const_cast<IceCream*>(top)));
+            }
+            else {
+                layers.push_back(
+                    make_unique<CaramelDecorator>(
+                        const_cast<IceCream*>(top)));
+            }
+            top = layers.back().get();
+        }
+
+        size_t calls = max<size_t>(20, 200000 / depth / depth);
+        size_t checksum = 0;
+        double recursiveCost = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < calls; ++i) {
+            recursiveCost = top->cost();
+            checksum += top->getDescription().size();
+        }
+        double recursiveNs = chrono::duration<double, nano>(
+                                 chrono::steady_clock::now()
+                                 - start)
+                                 .count()
+            / calls;
+
+        IceCreamStack flat = IceCreamStack::flatten(top);
+        bool same = flat.cost() == recursiveCost
+            && flat.description() == top->getDescription();
+        size_t cachedCalls = 1000000;
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < cachedCalls; ++i) {
+            checksum += size_t(flat.cost())
+                + flat.description().size();
+        }
+        double cachedNs = chrono::duration<double, nano>(
+                              chrono::steady_clock::now()
+                              - start)
+                              .count()
+            / cachedCalls;
+
+        size_t rebuilds = max<size_t>(20, 20000 / depth);
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < rebuilds; ++i) {
+            flat.push<CaramelDecorator>();
+            checksum += flat.description().size();
+            flat.pop();
+        }
+        double rebuildNs = chrono::duration<double, nano>(
+                               chrono::steady_clock::now()
+                               - start)
+                               .count()
+            / rebuilds;
+
+        cout << "Depth " << depth << ": recursive "
+             << recursiveNs << " ns/call, flattened "
+             << cachedNs << " ns/call, rebuild after change "
+             << rebuildNs << " ns ("
+             << (same ? "identical" : "MISMATCH") << ", "
+             << checksum % 1000 << ")" << endl;
+    }
+
+    // Receipt for 100k orders: getDescription() per line
+    // versus appendDescription() into one reused buffer.
+    VanillaIceCream receiptBase;
+    mt19937 receiptRng(9);
+    vector<unique_ptr<IceCream>> receiptLayers;
+    vector<const IceCream*> receiptItems;
+    for (int i = 0; i < 100000; ++i) {
+        IceCream* top = &receiptBase;
+        for (size_t d = receiptRng() % 5; d > 0; --d) {
+            if (receiptRng() % 2) {
+                receiptLayers.push_back(
+                    make_unique<ChocolateDecorator>(top));
+            }
+            else {
+                receiptLayers.push_back(
+                    make_unique<CaramelDecorator>(top));
+            }
+            top = receiptLayers.back().get();
+        }
+        receiptItems.push_back(top);
+    }
+
+    auto renderReceipt = [&](string& receipt, bool streamed) {
+        receipt.clear();
+        char price[32];
+        for (const IceCream* item : receiptItems) {
+            receipt += "Order: ";
+            if (streamed) {
+                item->appendDescription(receipt);
+            }
+            else {
+                receipt += item->getDescription();
+            }
+            int length = snprintf(price, sizeof(price),
+                ", Cost: Rs.%.2f\n", item->cost());
+            receipt.append(price, size_t(length));
+        }
+    };
+
+    string receipt;
+    renderReceipt(receipt, true); // size the buffer once
+    string expected = receipt;
+    for (bool streamed : { false, true }) {
+        size_t before = allocations;
+        auto began = chrono::steady_clock::now();
+        renderReceipt(receipt, streamed);
+        double ms = chrono::duration<double, milli>(
+            chrono::steady_clock::now() - began)
+                        .count();
+        cout << (streamed ? "appendDescription" : "getDescription")
+             << ": " << allocations - before
+             << " allocations, " << ms << " ms, "
+             << receipt.size() << " bytes"
+             << (receipt == expected ? "" : " MISMATCH")
+             << endl;
+    }
+
     return a.exec();
 }
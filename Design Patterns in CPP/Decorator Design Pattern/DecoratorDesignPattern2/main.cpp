@@ -1,28 +1,123 @@
 #include <QCoreApplication>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <random>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
+// Heap allocations so far, for the receipt benchmark.
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Destination for streamed descriptions.
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual void write(const char* text, size_t length) = 0;
+
+    template <size_t N>
+    void write(const char (&text)[N])
+    {
+        write(text, N - 1);
+    }
+};
+
+// Appends to a caller-owned string; allocates only when the
+// string has to grow.
+class StringSink : public Sink {
+public:
+    explicit StringSink(string& out)
+        : out(out)
+    {
+    }
+
+    void write(const char* text, size_t length) override
+    {
+        out.append(text, length);
+    }
+
+private:
+    string& out;
+};
+
+// Money in minor units (paise): exact, unlike double.
+using Money = int64_t;
+
+// Rupees, for the double-based Cake::cost() interface.
+constexpr double toRupees(Money amount) { return amount / 100.0; }
+
 // Component interface - defines the basic cake operations.
 class Cake {
 public:
+    virtual ~Cake() = default;
     virtual string getDescription() const = 0;
     virtual double cost() const = 0;
+
+    // Streams the description layer by layer, without
+    // building intermediate strings. The default goes
+    // through getDescription().
+    virtual void writeDescription(Sink& sink) const
+    {
+        string description = getDescription();
+        sink.write(description.data(), description.size());
+    }
+
+    void appendDescription(string& out) const
+    {
+        StringSink sink(out);
+        writeDescription(sink);
+    }
 };
 
 // Concrete Component - the basic cake class.
 class PlainCake : public Cake {
 public:
+    static constexpr string_view Label = "Plain Cake";
+
     string getDescription() const override
     {
-        return "Plain Cake";
+        return string(Label);
+    }
+
+    void writeDescription(Sink& sink) const override
+    {
+        sink.write(Label.data(), Label.size());
     }
 
-    double cost() const override { return 300.0; }
+    static constexpr Money Price = 30000;
+
+    double cost() const override { return toRupees(Price); }
 };
 
 // Decorator - abstract class that extends Cake.
+// Each layer appends topping() to the wrapped description
+// and adds toppingCost() to the wrapped cost.
 class CakeDecorator : public Cake {
 protected:
     Cake* cake;
@@ -35,10 +130,26 @@ public:
 
     string getDescription() const override
     {
-        return cake->getDescription();
+        string description = cake->getDescription();
+        description += topping();
+        return description;
+    }
+
+    void writeDescription(Sink& sink) const override
+    {
+        cake->writeDescription(sink);
+        string_view label = topping();
+        sink.write(label.data(), label.size());
     }
 
-    double cost() const override { return cake->cost(); }
+    double cost() const override
+    {
+        return cake->cost() + toppingCost();
+    }
+
+    // What this layer adds.
+    virtual string_view topping() const = 0;
+    virtual double toppingCost() const = 0;
 };
 
 // Concrete Decorator - adds chocolate topping.
@@ -49,14 +160,13 @@ public:
     {
     }
 
-    string getDescription() const override
-    {
-        return cake->getDescription() + " with Chocolate";
-    }
+    static constexpr string_view Label = " with Chocolate";
+    static constexpr Money Price = 20000;
 
-    double cost() const override
+    string_view topping() const override { return Label; }
+    double toppingCost() const override
     {
-        return cake->cost() + 200.0;
+        return toRupees(Price);
     }
 };
 
@@ -68,15 +178,143 @@ public:
     {
     }
 
-    string getDescription() const override
+    static constexpr string_view Label = " with Fruits";
+    static constexpr Money Price = 15000;
+
+    string_view topping() const override { return Label; }
+    double toppingCost() const override
     {
-        return cake->getDescription() + " with Fruits";
+        return toRupees(Price);
     }
+};
 
-    double cost() const override
+const Money PlainCakePrice = PlainCake::Price;
+
+enum class CakeAddOn : uint8_t { Chocolate, Fruit, Count };
+
+const size_t AddOnKinds = static_cast<size_t>(CakeAddOn::Count);
+
+// Indexed by CakeAddOn.
+const array<Money, AddOnKinds> AddOnPrices
+    = { ChocolateDecorator::Price, FruitDecorator::Price };
+
+// A batch of decorated cakes as a column-major table of
+// add-on ids: layer(l)[i] is the l-th add-on of item i, or
+// NoAddOn once item i has run out of layers. Items sit side
+// by side in each layer, which is what lets the pricing
+// engine work on many of them at once.
+class CakeBatch {
+public:
+    static constexpr uint8_t NoAddOn = 0xFF;
+
+    explicit CakeBatch(size_t items)
+        : depths(items, 0)
+    {
+    }
+
+    void add(size_t item, CakeAddOn addOn)
     {
-        return cake->cost() + 150.0;
+        if (depths[item] == layers.size()) {
+            layers.emplace_back(depths.size(), NoAddOn);
+        }
+        layers[depths[item]++][item]
+            = static_cast<uint8_t>(addOn);
     }
+
+    size_t size() const { return depths.size(); }
+    size_t depth() const { return layers.size(); }
+    size_t depth(size_t item) const { return depths[item]; }
+
+    const uint8_t* layer(size_t l) const
+    {
+        return layers[l].data();
+    }
+
+private:
+    vector<uint32_t> depths;
+    vector<vector<uint8_t>> layers;
+};
+
+// Prices a whole batch: price = base + sum over kinds of
+// (count of that add-on) * (its price). Add-ons are counted
+// 16 items at a time with SSE2 byte compares, in 8-bit
+// lanes flushed to 32-bit totals every 255 layers; the
+// final multiply-add is plain int64.
+class BulkPricingEngine {
+public:
+    BulkPricingEngine(Money base = PlainCakePrice,
+        const array<Money, AddOnKinds>& prices = AddOnPrices)
+        : base(base)
+        , prices(prices)
+    {
+    }
+
+    void price(const CakeBatch& batch, Money* out) const
+    {
+        const size_t items = batch.size();
+        const size_t depth = batch.depth();
+        uint32_t counts[AddOnKinds][Block];
+        size_t i = 0;
+#if defined(__SSE2__)
+        for (; i + Block <= items; i += Block) {
+            for (size_t k = 0; k < AddOnKinds; ++k) {
+                for (size_t j = 0; j < Block; ++j) {
+                    counts[k][j] = 0;
+                }
+            }
+            for (size_t l0 = 0; l0 < depth; l0 += 255) {
+                size_t l1 = min(depth, l0 + 255);
+                __m128i lanes[AddOnKinds];
+                for (size_t k = 0; k < AddOnKinds; ++k) {
+                    lanes[k] = _mm_setzero_si128();
+                }
+                for (size_t l = l0; l < l1; ++l) {
+                    __m128i ids = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(
+                            batch.layer(l) + i));
+                    for (size_t k = 0; k < AddOnKinds; ++k) {
+                        // cmpeq gives -1 per match
+                        lanes[k] = _mm_sub_epi8(lanes[k],
+                            _mm_cmpeq_epi8(ids,
+                                _mm_set1_epi8(char(k))));
+                    }
+                }
+                for (size_t k = 0; k < AddOnKinds; ++k) {
+                    alignas(16) uint8_t bytes[Block];
+                    _mm_store_si128(
+                        reinterpret_cast<__m128i*>(bytes),
+                        lanes[k]);
+                    for (size_t j = 0; j < Block; ++j) {
+                        counts[k][j] += bytes[j];
+                    }
+                }
+            }
+            for (size_t j = 0; j < Block; ++j) {
+                Money total = base;
+                for (size_t k = 0; k < AddOnKinds; ++k) {
+                    total += Money(counts[k][j]) * prices[k];
+                }
+                out[i + j] = total;
+            }
+        }
+#endif
+        for (; i < items; ++i) {
+            Money total = base;
+            for (size_t l = 0; l < depth; ++l) {
+                uint8_t id = batch.layer(l)[i];
+                if (id != CakeBatch::NoAddOn) {
+                    total += prices[id];
+                }
+            }
+            out[i] = total;
+        }
+    }
+
+private:
+    static constexpr size_t Block = 16;
+
+    Money base;
+    array<Money, AddOnKinds> prices;
 };
 
 int main(int argc, char *argv[])
@@ -112,5 +350,128 @@ int main(int argc, char *argv[])
     delete plainCake;
     delete fruitCake2;
 
+    // Catalog repricing: 1M cakes, 0-8 random add-ons each.
+    const size_t items = 1000000;
+    mt19937 rng(5);
+    CakeBatch batch(items);
+    for (size_t i = 0; i < items; ++i) {
+        for (size_t d = rng() % 9; d > 0; --d) {
+            batch.add(i, static_cast<CakeAddOn>(
+                             rng() % AddOnKinds));
+        }
+    }
+
+    BulkPricingEngine engine;
+    vector<Money> prices(items);
+    const int passes = 20;
+    auto start = chrono::steady_clock::now();
+    for (int p = 0; p < passes; ++p) {
+        engine.price(batch, prices.data());
+    }
+    double engineSeconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start)
+                               .count();
+
+    // The same cakes as decorator objects, 100k at a time.
+    PlainCake plain;
+    size_t mismatches = 0;
+    double decoratorSeconds = 0;
+    for (size_t first = 0; first < items; first += 100000) {
+        size_t last = min(items, first + 100000);
+        vector<unique_ptr<Cake>> layers;
+        vector<const Cake*> tops;
+        for (size_t i = first; i < last; ++i) {
+            Cake* top = &plain;
+            for (size_t l = 0; l < batch.depth(i); ++l) {
+                if (batch.layer(l)[i]
+                    == uint8_t(CakeAddOn::Chocolate)) {
+                    layers.push_back(
+                        make_unique<ChocolateDecorator>(top));
+                }
+                else {
+                    layers.push_back(
+                        make_unique<FruitDecorator>(top));
+                }
+                top = layers.back().get();
+            }
+            tops.push_back(top);
+        }
+        vector<double> costs(tops.size());
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < tops.size(); ++i) {
+            costs[i] = tops[i]->cost();
+        }
+        decoratorSeconds += chrono::duration<double>(
+            chrono::steady_clock::now() - start)
+                                .count();
+        for (size_t i = 0; i < tops.size(); ++i) {
+            mismatches += llround(costs[i] * 100)
+                != prices[first + i];
+        }
+    }
+
+    cout << "\nRepriced " << items << " cakes: engine "
+         << items * passes / engineSeconds / 1e6
+         << "M items/s, decorator objects "
+         << items / decoratorSeconds / 1e6 << "M items/s, "
+         << mismatches << " mismatches" << endl;
+
+    // Receipt for 100k cakes: getDescription() per line
+    // versus appendDescription() into one reused buffer.
+    PlainCake receiptBase;
+    mt19937 receiptRng(9);
+    vector<unique_ptr<Cake>> receiptLayers;
+    vector<const Cake*> receiptItems;
+    for (int i = 0; i < 100000; ++i) {
+        Cake* top = &receiptBase;
+        for (size_t d = receiptRng() % 5; d > 0; --d) {
+            if (receiptRng() % 2) {
+                receiptLayers.push_back(
+                    make_unique<ChocolateDecorator>(top));
+            }
+            else {
+                receiptLayers.push_back(
+                    make_unique<FruitDecorator>(top));
+            }
+            top = receiptLayers.back().get();
+        }
+        receiptItems.push_back(top);
+    }
+
+    auto renderReceipt = [&](string& receipt, bool streamed) {
+        receipt.clear();
+        char price[32];
+        for (const Cake* item : receiptItems) {
+            receipt += "Order: ";
+            if (streamed) {
+                item->appendDescription(receipt);
+            }
+            else {
+                receipt += item->getDescription();
+            }
+            int length = snprintf(price, sizeof(price),
+                ", Cost: Rs.%.2f\n", item->cost());
+            receipt.append(price, size_t(length));
+        }
+    };
+
+    string receipt;
+    renderReceipt(receipt, true); // size the buffer once
+    string expected = receipt;
+    for (bool streamed : { false, true }) {
+        size_t before = allocations;
+        auto began = chrono::steady_clock::now();
+        renderReceipt(receipt, streamed);
+        double ms = chrono::duration<double, milli>(
+            chrono::steady_clock::now() - began)
+                        .count();
+        cout << (streamed ? "appendDescription" : "getDescription")
+             << ": " << allocations - before
+             << " allocations, " << ms << " ms, "
+             << receipt.size() << " bytes"
+             << (receipt == expected ? "" : " MISMATCH")
+             << endl;
+    }
+
     return a.exec();
 }
@@ -1,18 +1,44 @@
 #include <QCoreApplication>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
 #include <string>
+#include <thread>
+#include <vector>
+
+enum class Operation { Takeoff, Landing };
+
+using TowerClock = std::chrono::steady_clock;
+
+// Where the tower reads the current time. Defaults to the wall clock;
+// a simulation supplies its own.
+using TimeSource = std::function<TowerClock::time_point()>;
 
 // Colleague Interface
 class Airplane {
 public:
+    virtual ~Airplane() = default;
     virtual void requestTakeoff() = 0;
     virtual void requestLanding() = 0;
     virtual void notifyAirTrafficControl(const std::string& message) = 0;
+
+    // Structured form of a clearance: the runway is reserved for this
+    // airplane from slotStart to slotEnd.
+    virtual void clearanceGranted(Operation, int /*runway*/, TowerClock::time_point /*slotStart*/,
+                                  TowerClock::time_point /*slotEnd*/) {}
 };
 
 // Mediator Interface
 class AirTrafficControlTower {
 public:
+    virtual ~AirTrafficControlTower() = default;
     virtual void requestTakeoff(Airplane* airplane) = 0;
     virtual void requestLanding(Airplane* airplane) = 0;
 };
@@ -40,18 +66,462 @@ public:
 };
 
 
+// Runway timing rules. Each operation occupies the runway for a while,
+// and consecutive operations need extra separation (more when a takeoff
+// follows a landing or the other way round, for wake turbulence).
+struct RunwayPolicy {
+    std::chrono::microseconds takeoffOccupancy{20};
+    std::chrono::microseconds landingOccupancy{30};
+    std::chrono::microseconds separation{5};
+    std::chrono::microseconds mixedSeparation{10};
+};
+
+// Fixed-size latency histogram: each power of two is split into 8
+// linear sub-buckets, so a percentile is exact to within 1/8 of its
+// value and memory stays constant however many clearances are recorded.
+class LatencyHistogram {
+public:
+    static constexpr int SubBuckets = 8;
+    static constexpr int Buckets = 64 * SubBuckets;
+
+    void record(int64_t nanos)
+    {
+        uint64_t value = nanos > 0 ? static_cast<uint64_t>(nanos) : 0;
+        counts[bucketOf(value)]++;
+        count++;
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < Buckets; ++i) {
+            counts[i] += other.counts[i];
+        }
+        count += other.count;
+    }
+
+    uint64_t total() const { return count; }
+
+    // Upper bound (in ns) of the bucket holding the given percentile.
+    uint64_t percentile(double p) const
+    {
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * count);
+        uint64_t seen = 0;
+        for (int i = 0; i < Buckets; ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                return upperBound(i);
+            }
+        }
+        return 0;
+    }
+
+private:
+    // Values below SubBuckets get a bucket each; above that, the top bit
+    // picks the power of two and the next three bits the sub-bucket.
+    static int bucketOf(uint64_t value)
+    {
+        if (value < SubBuckets) {
+            return static_cast<int>(value);
+        }
+        int top = 3;
+        while (top < 63 && (value >> (top + 1)) != 0) {
+            ++top;
+        }
+        int shift = top - 3;
+        return (shift + 1) * SubBuckets + static_cast<int>((value >> shift) & (SubBuckets - 1));
+    }
+
+    static uint64_t upperBound(int bucket)
+    {
+        if (bucket < SubBuckets) {
+            return static_cast<uint64_t>(bucket);
+        }
+        int shift = bucket / SubBuckets - 1;
+        uint64_t mantissa = static_cast<uint64_t>(bucket % SubBuckets + SubBuckets);
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    uint64_t counts[Buckets] = {};
+    uint64_t count = 0;
+};
+
+// One runway: a priority queue of pending requests plus the schedule of
+// granted slots. Any requesting thread may issue clearances, but only one
+// at a time per runway; there is no tower-wide lock.
+class Runway {
+public:
+    using Clock = TowerClock;
+
+    struct Stats {
+        uint64_t clearances = 0;
+        Clock::duration busy{0};
+        Clock::time_point firstStart;
+        Clock::time_point lastEnd;
+        LatencyHistogram latency; // request -> granted slot
+    };
+
+    Runway(int number, const RunwayPolicy& policy, TimeSource now)
+        : number(number), policy(policy), now(std::move(now))
+    {
+    }
+
+    // End of the last granted slot; read without locking to balance
+    // requests across runways.
+    int64_t nextFree() const { return nextFreeNs.load(std::memory_order_relaxed); }
+
+    // Returns once this request has been cleared, possibly by another
+    // thread that was issuing clearances at the time.
+    void request(Airplane* airplane, Operation operation)
+    {
+        std::atomic<bool> cleared{false};
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            // Landings first (they cannot wait forever), then FIFO.
+            queue.push(Request{airplane, operation, operation == Operation::Landing ? 1 : 0,
+                               sequence++, now(), &cleared});
+            // Counted under the same lock as the push, so pop() can never
+            // take the request before it is counted and wrap waiting.
+            waiting.fetch_add(1);
+        }
+        issueClearances();
+        while (!cleared.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    Stats stats()
+    {
+        std::lock_guard<std::mutex> lock(scheduleMutex);
+        return schedule;
+    }
+
+private:
+    struct Request {
+        Airplane* airplane;
+        Operation operation;
+        int priority;
+        uint64_t sequence;
+        Clock::time_point requested;
+        std::atomic<bool>* cleared;
+
+        bool operator<(const Request& other) const
+        {
+            if (priority != other.priority) {
+                return priority < other.priority;
+            }
+            return sequence > other.sequence;
+        }
+    };
+
+    // Whoever gets the schedule lock drains the queue for everyone. A
+    // thread that misses the lock leaves its request behind; the holder
+    // re-checks the backlog after unlocking, so nothing is stranded.
+    void issueClearances()
+    {
+        while (waiting.load() > 0) {
+            std::unique_lock<std::mutex> scheduleLock(scheduleMutex, std::try_to_lock);
+            if (!scheduleLock.owns_lock()) {
+                return;
+            }
+            Request next;
+            while (pop(next)) {
+                grant(next);
+            }
+        }
+    }
+
+    bool pop(Request& out)
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.empty()) {
+            return false;
+        }
+        out = queue.top();
+        queue.pop();
+        waiting.fetch_sub(1);
+        return true;
+    }
+
+    // Caller holds scheduleMutex.
+    void grant(const Request& request)
+    {
+        Clock::time_point current = now();
+        Clock::time_point slot = current;
+        if (schedule.clearances > 0) {
+            auto gap = request.operation == lastOperation ? policy.separation
+                                                           : policy.mixedSeparation;
+            slot = std::max(current, schedule.lastEnd + gap);
+        } else {
+            schedule.firstStart = slot;
+        }
+        auto occupancy = request.operation == Operation::Takeoff ? policy.takeoffOccupancy
+                                                                  : policy.landingOccupancy;
+        schedule.lastEnd = slot + occupancy;
+        schedule.busy += occupancy;
+        schedule.clearances++;
+        schedule.latency.record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(slot - request.requested).count());
+        lastOperation = request.operation;
+
+        auto wait = std::chrono::duration_cast<std::chrono::microseconds>(slot - current).count();
+        request.airplane->notifyAirTrafficControl(
+            std::string(request.operation == Operation::Takeoff ? "Cleared for takeoff"
+                                                                : "Cleared to land")
+            + " on runway " + std::to_string(number) + " in " + std::to_string(wait) + " us.");
+        request.airplane->clearanceGranted(request.operation, number, slot, schedule.lastEnd);
+        nextFreeNs.store(schedule.lastEnd.time_since_epoch().count(), std::memory_order_relaxed);
+        request.cleared->store(true, std::memory_order_release);
+    }
+
+    int number;
+    RunwayPolicy policy;
+    TimeSource now;
+
+    std::mutex queueMutex;
+    std::priority_queue<Request> queue;
+    uint64_t sequence = 0;
+    std::atomic<size_t> waiting{0};
+
+    std::mutex scheduleMutex;
+    Stats schedule;
+    Operation lastOperation = Operation::Takeoff;
+    std::atomic<int64_t> nextFreeNs{0};
+};
+
 // Concrete Mediator
 class AirportControlTower : public AirTrafficControlTower {
 public:
+    explicit AirportControlTower(int runwayCount = 2, const RunwayPolicy& policy = RunwayPolicy(),
+                                 TimeSource now = &TowerClock::now)
+    {
+        for (int i = 0; i < runwayCount; ++i) {
+            runways.push_back(std::make_unique<Runway>(i + 1, policy, now));
+        }
+    }
+
     void requestTakeoff(Airplane* airplane) override {
         // Logic for coordinating takeoff
-        airplane->notifyAirTrafficControl("Requesting takeoff clearance.");
+        earliestFreeRunway().request(airplane, Operation::Takeoff);
     }
 
     void requestLanding(Airplane* airplane) override {
         // Logic for coordinating landing
-        airplane->notifyAirTrafficControl("Requesting landing clearance.");
+        earliestFreeRunway().request(airplane, Operation::Landing);
+    }
+
+    void printReport()
+    {
+        LatencyHistogram latency;
+        uint64_t clearances = 0;
+        for (auto& runway : runways) {
+            Runway::Stats stats = runway->stats();
+            clearances += stats.clearances;
+            latency.merge(stats.latency);
+            double span = std::chrono::duration<double>(stats.lastEnd - stats.firstStart).count();
+            double busy = std::chrono::duration<double>(stats.busy).count();
+            std::cout << "Runway utilization: " << (span > 0 ? 100.0 * busy / span : 0.0)
+                      << "% over " << stats.clearances << " operations" << std::endl;
+        }
+        if (latency.total() == 0) {
+            return;
+        }
+        std::cout << clearances << " clearances, latency to slot p50 <= "
+                  << latency.percentile(50) / 1000 << " us, p99 <= "
+                  << latency.percentile(99) / 1000 << " us, p99.9 <= "
+                  << latency.percentile(99.9) / 1000 << " us" << std::endl;
+    }
+
+private:
+    Runway& earliestFreeRunway()
+    {
+        Runway* best = runways.front().get();
+        for (auto& runway : runways) {
+            if (runway->nextFree() < best->nextFree()) {
+                best = runway.get();
+            }
+        }
+        return *best;
+    }
+
+    std::vector<std::unique_ptr<Runway>> runways;
+};
+
+// Discrete-event simulation of a day of traffic through the tower.
+// Time is simulated (microseconds since midnight); events are kept in a
+// 4-ary min-heap of 16-byte entries and their payloads live in a pool
+// with a free list, so the steady state does not allocate. Equal-time
+// events run in scheduling order, and the only randomness comes from
+// the seeded generator, so a seed always replays the same day.
+class TrafficSimulation {
+public:
+    enum class EventType : uint8_t { RequestLanding, Landed, RequestTakeoff, Departed };
+
+    struct Result {
+        uint64_t events = 0;
+        uint64_t checksum = 0; // of all granted slots; equal for equal seeds
+        int64_t lastEventUs = 0;
+    };
+
+    TrafficSimulation(size_t aircraftCount, int runways, const RunwayPolicy& policy,
+                      uint64_t seed)
+        : tower(runways, policy, [this] { return TowerClock::time_point(std::chrono::microseconds(clock)); }),
+          rng(seed)
+    {
+        fleet.reserve(aircraftCount);
+        for (size_t i = 0; i < aircraftCount; ++i) {
+            fleet.emplace_back(*this, static_cast<uint32_t>(i));
+        }
+    }
+
+    Result run()
+    {
+        const uint64_t day = 24ull * 3600 * 1000000;
+        for (SimulatedAirplane& plane : fleet) {
+            schedule(rng() % day, EventType::RequestLanding, plane.id);
+        }
+        while (!heap.empty()) {
+            HeapEntry top = popMin();
+            clock = static_cast<int64_t>(top.time);
+            Event event = pool[top.event];
+            release(top.event);
+            dispatch(event);
+            result.events++;
+        }
+        result.lastEventUs = clock;
+        return result;
+    }
+
+private:
+    class SimulatedAirplane : public CommercialAirplane {
+    public:
+        SimulatedAirplane(TrafficSimulation& sim, uint32_t id)
+            : CommercialAirplane(&sim.tower), sim(&sim), id(id)
+        {
+        }
+
+        void notifyAirTrafficControl(const std::string&) override {}
+
+        void clearanceGranted(Operation operation, int, TowerClock::time_point slotStart,
+                              TowerClock::time_point slotEnd) override
+        {
+            sim->result.checksum = sim->result.checksum * 31
+                + static_cast<uint64_t>(slotStart.time_since_epoch().count());
+            auto end = std::chrono::duration_cast<std::chrono::microseconds>(
+                slotEnd.time_since_epoch()).count();
+            sim->schedule(static_cast<uint64_t>(end),
+                          operation == Operation::Landing ? EventType::Landed : EventType::Departed,
+                          id);
+        }
+
+        TrafficSimulation* sim;
+        uint32_t id;
+    };
+
+    struct Event {
+        EventType type;
+        uint32_t aircraft;
+    };
+
+    struct HeapEntry {
+        uint64_t time;
+        uint32_t order; // tie-break: scheduling order
+        uint32_t event; // index into pool
+        bool operator<(const HeapEntry& other) const
+        {
+            return time != other.time ? time < other.time : order < other.order;
+        }
+    };
+
+    void dispatch(const Event& event)
+    {
+        SimulatedAirplane& plane = fleet[event.aircraft];
+        switch (event.type) {
+        case EventType::RequestLanding:
+            plane.requestLanding();
+            break;
+        case EventType::Landed: {
+            // Turnaround of 30-90 minutes before asking to depart again.
+            uint64_t turnaround = (30 + rng() % 61) * 60ull * 1000000;
+            schedule(static_cast<uint64_t>(clock) + turnaround, EventType::RequestTakeoff, plane.id);
+            break;
+        }
+        case EventType::RequestTakeoff:
+            plane.requestTakeoff();
+            break;
+        case EventType::Departed:
+            break;
+        }
+    }
+
+    void schedule(uint64_t time, EventType type, uint32_t aircraft)
+    {
+        uint32_t index;
+        if (!freeEvents.empty()) {
+            index = freeEvents.back();
+            freeEvents.pop_back();
+        } else {
+            index = static_cast<uint32_t>(pool.size());
+            pool.emplace_back();
+        }
+        pool[index] = Event{type, aircraft};
+        push(HeapEntry{time, order++, index});
     }
+
+    void release(uint32_t index) { freeEvents.push_back(index); }
+
+    void push(const HeapEntry& entry)
+    {
+        size_t i = heap.size();
+        heap.push_back(entry);
+        while (i > 0) {
+            size_t parent = (i - 1) / 4;
+            if (!(heap[i] < heap[parent])) {
+                break;
+            }
+            std::swap(heap[i], heap[parent]);
+            i = parent;
+        }
+    }
+
+    HeapEntry popMin()
+    {
+        HeapEntry top = heap.front();
+        HeapEntry last = heap.back();
+        heap.pop_back();
+        size_t n = heap.size();
+        size_t i = 0;
+        while (n > 0) {
+            size_t first = 4 * i + 1;
+            if (first >= n) {
+                break;
+            }
+            size_t best = first;
+            for (size_t c = first + 1; c < std::min(first + 4, n); ++c) {
+                if (heap[c] < heap[best]) {
+                    best = c;
+                }
+            }
+            if (!(heap[best] < last)) {
+                break;
+            }
+            heap[i] = heap[best];
+            i = best;
+        }
+        if (n > 0) {
+            heap[i] = last;
+        }
+        return top;
+    }
+
+    int64_t clock = 0;
+    AirportControlTower tower;
+    std::mt19937_64 rng;
+    std::vector<SimulatedAirplane> fleet;
+    std::vector<HeapEntry> heap;
+    std::vector<Event> pool;
+    std::vector<uint32_t> freeEvents;
+    uint32_t order = 0;
+    Result result;
 };
 
 // Main class
@@ -71,12 +541,61 @@ int main(int argc, char *argv[])
     airplane2->requestLanding();
 
     // Output:
-    // Commercial Airplane: Requesting takeoff clearance.
-    // Commercial Airplane: Requesting landing clearance.
+    // Commercial Airplane: Cleared for takeoff on runway 1 in 0 us.
+    // Commercial Airplane: Cleared to land on runway 2 in 0 us.
 
     delete controlTower;
     delete airplane1;
     delete airplane2;
 
+    // Load test: 100k requests/sec from several threads for one second.
+    class QuietAirplane : public CommercialAirplane {
+    public:
+        using CommercialAirplane::CommercialAirplane;
+        void notifyAirTrafficControl(const std::string&) override {}
+    };
+
+    RunwayPolicy policy;
+    AirportControlTower tower(4, policy);
+    const int threads = 4;
+    const int perThread = 25000;
+    std::vector<std::thread> pilots;
+    auto begin = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        pilots.emplace_back([&tower, t, begin] {
+            QuietAirplane plane(&tower);
+            for (int i = 0; i < perThread; ++i) {
+                // Pace each thread at 25k requests/sec.
+                std::this_thread::sleep_until(begin + std::chrono::microseconds(i * 40));
+                if ((i + t) % 2 == 0) {
+                    plane.requestTakeoff();
+                } else {
+                    plane.requestLanding();
+                }
+            }
+        });
+    }
+    for (std::thread& pilot : pilots) {
+        pilot.join();
+    }
+    tower.printReport();
+
+    // Replay a day with 100k aircraft, twice with the same seed.
+    RunwayPolicy dayPolicy;
+    dayPolicy.takeoffOccupancy = std::chrono::seconds(40);
+    dayPolicy.landingOccupancy = std::chrono::seconds(50);
+    dayPolicy.separation = std::chrono::seconds(20);
+    dayPolicy.mixedSeparation = std::chrono::seconds(40);
+    for (int run = 0; run < 2; ++run) {
+        TrafficSimulation simulation(100000, 200, dayPolicy, 2024);
+        auto simStart = std::chrono::steady_clock::now();
+        TrafficSimulation::Result result = simulation.run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - simStart).count();
+        std::cout << "Simulated " << result.events << " events ("
+                  << result.lastEventUs / 3600000000.0 << " h) in " << seconds * 1000
+                  << " ms, " << static_cast<uint64_t>(result.events / seconds)
+                  << " events/sec, checksum " << result.checksum << std::endl;
+    }
+
     return a.exec();
 }
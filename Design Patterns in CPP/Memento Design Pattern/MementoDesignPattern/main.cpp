@@ -1,19 +1,64 @@
 #include <QCoreApplication>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 // Originator: The object whose state needs to be saved and restored.
 class Originator {
 private:
     std::string state;
 
+    // Bytes changed since the last memento or delta, as [dirtyBegin,
+    // dirtyEnd). Empty when dirtyBegin == dirtyEnd.
+    size_t dirtyBegin = 0;
+    size_t dirtyEnd = 0;
+
+    void MarkDirty(size_t begin, size_t end) {
+        if (dirtyBegin == dirtyEnd) {
+            dirtyBegin = begin;
+            dirtyEnd = end;
+        } else {
+            dirtyBegin = std::min(dirtyBegin, begin);
+            dirtyEnd = std::max(dirtyEnd, end);
+        }
+    }
+
 public:
     void SetState(const std::string& newState) {
         state = newState;
+        MarkDirty(0, state.size());
+    }
+
+    // Overwrite part of the state in place, growing it if needed.
+    void Write(size_t offset, std::string_view text) {
+        if (offset + text.size() > state.size()) {
+            state.resize(offset + text.size());
+        }
+        state.replace(offset, text.size(), text.data(), text.size());
+        MarkDirty(offset, offset + text.size());
     }
 
-    std::string GetState() const {
+    const std::string& GetState() const {
         return state;
     }
 
@@ -25,38 +70,673 @@ public:
     public:
         Memento(const std::string& originatorState) : state(originatorState) {}
 
-        std::string GetSavedState() const {
+        const std::string& GetSavedState() const {
             return state;
         }
     };
 
+    // Delta: the bytes that changed since the previous memento or delta.
+    // Applying it to that earlier state gives this one.
+    class Delta {
+    private:
+        size_t offset = 0;
+        size_t size = 0; // size of the whole state afterwards
+        std::string bytes;
+
+    public:
+        Delta() = default;
+        Delta(size_t offset, size_t size, std::string_view bytes)
+            : offset(offset), size(size), bytes(bytes) {}
+
+        size_t GetOffset() const {
+            return offset;
+        }
+
+        size_t GetSize() const {
+            return size;
+        }
+
+        const std::string& GetBytes() const {
+            return bytes;
+        }
+    };
+
     // Create a Memento object to save the current state.
     Memento CreateMemento() const {
         return Memento(state);
     }
 
-    // Restore the state from a Memento object.
+    // Start tracking changes from the current state. A delta caretaker
+    // calls this once it has stored a full copy of the state.
+    void MarkClean() {
+        dirtyBegin = dirtyEnd = 0;
+    }
+
+    // Take the changes since the last MarkClean() or TakeDelta() as a
+    // Delta, and start tracking again from here.
+    Delta TakeDelta() {
+        size_t end = std::min(dirtyEnd, state.size());
+        size_t begin = std::min(dirtyBegin, end);
+        Delta delta(begin, state.size(), std::string_view(state).substr(begin, end - begin));
+        MarkClean();
+        return delta;
+    }
+
+    // Restore the state from a Memento object. The whole state now
+    // differs from whatever was saved last, so it is all dirty.
     void RestoreState(const Memento& memento) {
-        state = memento.GetSavedState();
+        RestoreState(std::string_view(memento.GetSavedState()));
+    }
+
+    void RestoreState(std::string_view savedState) {
+        state.assign(savedState.data(), savedState.size());
+        MarkDirty(0, state.size());
+    }
+
+    void ApplyDelta(const Delta& delta) {
+        state.resize(delta.GetSize());
+        state.replace(delta.GetOffset(), delta.GetBytes().size(), delta.GetBytes());
+        MarkDirty(0, state.size());
     }
 };
 
 // Caretaker: Manages the Memento objects.
+//
+// With a keyframe interval of 0 every checkpoint is a full Memento. With
+// an interval of N, every Nth checkpoint is a full keyframe and the ones
+// in between are Deltas against the checkpoint before them. Restoring
+// copies the keyframe once and replays at most N - 1 deltas over it.
 class Caretaker {
 private:
-    std::vector<Originator::Memento> mementos;
+    struct Entry {
+        size_t keyframe;         // index into keyframes
+        Originator::Delta delta; // unused for keyframe entries
+        bool isKeyframe;
+    };
+
+    std::vector<Originator::Memento> keyframes;
+    std::vector<Entry> entries;
+    size_t keyframeInterval;
+
+    // Last state materialized by View(), reused for sequential access.
+    std::string scratch;
+    size_t scratchIndex = SIZE_MAX;
+
+    void CheckIndex(size_t index) const {
+        if (index >= entries.size()) {
+            throw std::out_of_range("Invalid Memento index");
+        }
+    }
+
+    // First entry to replay from when materializing index into scratch.
+    size_t ReplayStart(size_t index) {
+        size_t key = entries[index].keyframe;
+        bool scratchUsable = scratchIndex != SIZE_MAX && scratchIndex <= index
+            && entries[scratchIndex].keyframe == key;
+        if (scratchUsable) {
+            return scratchIndex + 1;
+        }
+        size_t first = index;
+        while (!entries[first].isKeyframe) {
+            --first;
+        }
+        scratch = keyframes[key].GetSavedState();
+        return first + 1;
+    }
+
+    static void Apply(std::string& target, const Originator::Delta& delta) {
+        target.resize(delta.GetSize());
+        target.replace(delta.GetOffset(), delta.GetBytes().size(), delta.GetBytes());
+    }
 
 public:
+    explicit Caretaker(size_t keyframeInterval = 0) : keyframeInterval(keyframeInterval) {}
+
     void AddMemento(const Originator::Memento& memento) {
-        mementos.push_back(memento);
+        keyframes.push_back(memento);
+        entries.push_back(Entry{keyframes.size() - 1, Originator::Delta(), true});
+    }
+
+    void AddMemento(Originator::Memento&& memento) {
+        keyframes.push_back(std::move(memento));
+        entries.push_back(Entry{keyframes.size() - 1, Originator::Delta(), true});
     }
 
-    Originator::Memento GetMemento(int index) const {
-        if (index >= 0 && index < mementos.size()) {
-            return mementos[index];
+    // Save the originator's current state as a keyframe or a delta. The
+    // originator's change tracking restarts at every checkpoint.
+    void Checkpoint(Originator& originator) {
+        if (keyframeInterval == 0 || entries.size() % keyframeInterval == 0) {
+            AddMemento(originator.CreateMemento());
+            originator.MarkClean();
+        } else {
+            entries.push_back(Entry{keyframes.size() - 1, originator.TakeDelta(), false});
+        }
+    }
+
+    // Only keyframes are stored as Mementos; use Restore() or View() for
+    // delta checkpoints.
+    const Originator::Memento& GetMemento(int index) const {
+        if (index >= 0 && static_cast<size_t>(index) < entries.size()
+            && entries[index].isKeyframe) {
+            return keyframes[entries[index].keyframe];
         }
         throw std::out_of_range("Invalid Memento index");
     }
+
+    // One copy of the keyframe into the originator, then the deltas in
+    // place.
+    void Restore(size_t index, Originator& originator) {
+        CheckIndex(index);
+        size_t first = index;
+        while (!entries[first].isKeyframe) {
+            --first;
+        }
+        originator.RestoreState(keyframes[entries[first].keyframe]);
+        for (size_t i = first + 1; i <= index; ++i) {
+            originator.ApplyDelta(entries[i].delta);
+        }
+    }
+
+    // Read-only view of a checkpoint. Keyframes are returned in place;
+    // deltas are materialized into an internal buffer, which stays valid
+    // until the next call.
+    std::string_view View(size_t index) {
+        CheckIndex(index);
+        if (entries[index].isKeyframe) {
+            return keyframes[entries[index].keyframe].GetSavedState();
+        }
+        for (size_t i = ReplayStart(index); i <= index; ++i) {
+            Apply(scratch, entries[i].delta);
+        }
+        scratchIndex = index;
+        return scratch;
+    }
+
+    size_t Count() const {
+        return entries.size();
+    }
+
+    // Heap bytes held by the history.
+    size_t HistoryBytes() const {
+        size_t bytes = entries.capacity() * sizeof(Entry);
+        for (const Originator::Memento& keyframe : keyframes) {
+            bytes += keyframe.GetSavedState().capacity();
+        }
+        for (const Entry& entry : entries) {
+            bytes += entry.delta.GetBytes().capacity();
+        }
+        return bytes;
+    }
+};
+
+// PersistentCaretaker: keeps mementos in memory-mapped segment files
+// instead of the heap.
+//
+// Each memento is appended as one record: a 24-byte header followed by
+// the saved bytes, padded to 8. The payload is synced before the header
+// is written and synced, so after a crash a record is either complete
+// or its header is still zero. Reopening the directory only walks the
+// headers to rebuild the index of offsets. Nothing is copied into RAM,
+// and restoring an index maps straight onto the file.
+//
+// Forget() drops old history. A background thread then deletes segments
+// that hold no live records and rewrites sparse ones into smaller files.
+class PersistentCaretaker {
+private:
+    struct Segment {
+        uint32_t id = 0;
+        std::string path;
+        char* data = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+
+        ~Segment() {
+            if (data) {
+                munmap(data, capacity);
+            }
+        }
+    };
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t reserved;
+        uint64_t sequence;
+        uint64_t length;
+    };
+
+    struct Location {
+        uint32_t segment;
+        size_t offset; // of the payload
+        size_t length;
+    };
+
+    static const uint32_t RecordMagic = 0x4D454D4F; // "MEMO"
+
+    static size_t RecordBytes(size_t length) {
+        return sizeof(RecordHeader) + ((length + 7) & ~size_t(7));
+    }
+
+public:
+    // A restored memento: a view of the mapped file. It keeps its
+    // segment mapped, so compaction cannot pull the bytes out from under
+    // it.
+    class MappedMemento {
+    private:
+        std::shared_ptr<const Segment> segment;
+        std::string_view state;
+
+    public:
+        MappedMemento(std::shared_ptr<const Segment> segment, std::string_view state)
+            : segment(std::move(segment)), state(state) {}
+
+        std::string_view GetSavedState() const {
+            return state;
+        }
+    };
+
+    PersistentCaretaker(const std::string& directory, size_t segmentBytes = size_t(64) << 20,
+                        bool syncEachAppend = true)
+        : directory(directory),
+          segmentBytes(segmentBytes),
+          syncEachAppend(syncEachAppend),
+          pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+        std::filesystem::create_directories(directory);
+        Recover();
+        compactor = std::thread([this] { CompactLoop(); });
+    }
+
+    ~PersistentCaretaker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        compactor.join();
+    }
+
+    PersistentCaretaker(const PersistentCaretaker&) = delete;
+    PersistentCaretaker& operator=(const PersistentCaretaker&) = delete;
+
+    // Returns the memento's index. With syncEachAppend it is on disk when
+    // this returns.
+    size_t AddMemento(const Originator::Memento& memento) {
+        const std::string& state = memento.GetSavedState();
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t bytes = RecordBytes(state.size());
+        if (!active || active->used + bytes > active->capacity) {
+            active = CreateSegment(std::max(segmentBytes, bytes));
+        }
+        size_t offset = active->used;
+        uint64_t sequence = firstIndex + index.size();
+        std::memcpy(active->data + offset + sizeof(RecordHeader), state.data(), state.size());
+        if (syncEachAppend) {
+            Sync(*active, offset + sizeof(RecordHeader), offset + bytes);
+        }
+        RecordHeader header{RecordMagic, 0, sequence, state.size()};
+        std::memcpy(active->data + offset, &header, sizeof(header));
+        if (syncEachAppend) {
+            Sync(*active, offset, offset + sizeof(header));
+        }
+        active->used += bytes;
+        index.push_back(Location{active->id, offset + sizeof(RecordHeader), state.size()});
+        return static_cast<size_t>(sequence);
+    }
+
+    // O(1): an index lookup and a pointer into the mapping.
+    MappedMemento GetMemento(size_t i) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (i < firstIndex || i - firstIndex >= index.size()) {
+            throw std::out_of_range("Invalid Memento index");
+        }
+        const Location& location = index[i - firstIndex];
+        const std::shared_ptr<Segment>& segment = segments.at(location.segment);
+        return MappedMemento(segment,
+                             std::string_view(segment->data + location.offset, location.length));
+    }
+
+    void Restore(size_t i, Originator& originator) const {
+        originator.RestoreState(GetMemento(i).GetSavedState());
+    }
+
+    // Valid indices are [FirstIndex(), EndIndex()).
+    size_t FirstIndex() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<size_t>(firstIndex);
+    }
+
+    size_t EndIndex() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<size_t>(firstIndex + index.size());
+    }
+
+    // Drops every memento before index `keepFrom`. The cut is made
+    // durable first, then the compactor is woken to reclaim the space.
+    void Forget(size_t keepFrom) {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t end = firstIndex + index.size();
+        uint64_t cut = std::min<uint64_t>(std::max<uint64_t>(keepFrom, firstIndex), end);
+        if (cut == firstIndex) {
+            return;
+        }
+        WriteRetention(cut);
+        index.erase(index.begin(), index.begin() + static_cast<ptrdiff_t>(cut - firstIndex));
+        firstIndex = cut;
+        ++compactionRequests;
+        lock.unlock();
+        wake.notify_all();
+    }
+
+    // Blocks until the compactor has handled every request so far.
+    void WaitForCompaction() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t target = compactionRequests;
+        idle.wait(lock, [&] { return compactionsDone >= target; });
+    }
+
+    size_t SegmentCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return segments.size();
+    }
+
+    size_t DiskBytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t bytes = 0;
+        for (const auto& entry : segments) {
+            bytes += entry.second->capacity;
+        }
+        return bytes;
+    }
+
+private:
+    std::string SegmentPath(uint32_t id) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/segment-%08u.seg", id);
+        return directory + name;
+    }
+
+    void Sync(const Segment& segment, size_t begin, size_t end) const {
+        begin -= begin % pageSize;
+        if (msync(segment.data + begin, end - begin, MS_SYNC) != 0) {
+            throw std::runtime_error("msync failed on memento segment");
+        }
+    }
+
+    std::shared_ptr<Segment> MapSegment(uint32_t id, size_t capacity, bool create) {
+        auto segment = std::make_shared<Segment>();
+        segment->id = id;
+        segment->path = SegmentPath(id);
+        int fd = ::open(segment->path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open memento segment");
+        }
+        if (create && ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot size memento segment");
+        }
+        if (!create) {
+            struct stat info;
+            if (fstat(fd, &info) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Cannot stat memento segment");
+            }
+            capacity = static_cast<size_t>(info.st_size);
+        }
+        void* data = capacity ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                              : nullptr;
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map memento segment");
+        }
+        segment->data = static_cast<char*>(data);
+        segment->capacity = capacity;
+        return segment;
+    }
+
+    // Makes file creations, renames and removals in the store durable.
+    void SyncDirectory() const {
+        int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open memento directory");
+        }
+        int result = fsync(fd);
+        ::close(fd);
+        if (result != 0) {
+            throw std::runtime_error("fsync failed on memento directory");
+        }
+    }
+
+    // Zeroes [from, capacity) of a segment on disk, so bytes left by an
+    // interrupted write can never be read back as a record once new
+    // records are appended in front of them. Whole pages are punched out
+    // of the file where the file system supports it.
+    void ZeroTail(Segment& segment, size_t from) {
+        if (from >= segment.capacity) {
+            return;
+        }
+        size_t pageEnd = std::min(segment.capacity, (from + pageSize - 1) / pageSize * pageSize);
+        std::memset(segment.data + from, 0, pageEnd - from);
+        int fd = ::open(segment.path.c_str(), O_RDWR);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open memento segment");
+        }
+        bool punched = pageEnd == segment.capacity
+            || fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                         static_cast<off_t>(pageEnd),
+                         static_cast<off_t>(segment.capacity - pageEnd)) == 0;
+        if (!punched) {
+            std::memset(segment.data + pageEnd, 0, segment.capacity - pageEnd);
+        }
+        int result = msync(segment.data + (from - from % pageSize),
+                           (punched ? pageEnd : segment.capacity) - (from - from % pageSize),
+                           MS_SYNC);
+        result = result == 0 ? fsync(fd) : result;
+        ::close(fd);
+        if (result != 0) {
+            throw std::runtime_error("Cannot clear memento segment tail");
+        }
+    }
+
+    // Caller holds the mutex.
+    std::shared_ptr<Segment> CreateSegment(size_t capacity) {
+        std::shared_ptr<Segment> segment = MapSegment(nextSegment++, capacity, true);
+        SyncDirectory();
+        segments[segment->id] = segment;
+        return segment;
+    }
+
+    void WriteRetention(uint64_t keepFrom) {
+        std::string tmp = directory + "/retention.tmp";
+        std::FILE* file = std::fopen(tmp.c_str(), "wb");
+        bool ok = file && std::fwrite(&keepFrom, sizeof(keepFrom), 1, file) == 1
+            && std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+        if (file) {
+            ok = std::fclose(file) == 0 && ok;
+        }
+        if (!ok) {
+            throw std::runtime_error("Failed to write memento retention");
+        }
+        std::filesystem::rename(tmp, directory + "/retention.bin");
+        SyncDirectory();
+    }
+
+    // Walks record headers only. A record counts once even if a crash
+    // mid-compaction left it in two segments; the copy in the later
+    // segment wins. History ends at the first missing index. Records past
+    // that gap are leftovers of writes a crash cut short, and their
+    // sequence numbers are about to be reused, so they are wiped.
+    void Recover() {
+        uint64_t keepFrom = 0;
+        if (std::FILE* file = std::fopen((directory + "/retention.bin").c_str(), "rb")) {
+            if (std::fread(&keepFrom, sizeof(keepFrom), 1, file) != 1) {
+                keepFrom = 0;
+            }
+            std::fclose(file);
+        }
+
+        std::vector<uint32_t> ids;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            unsigned id;
+            if (std::sscanf(entry.path().filename().string().c_str(), "segment-%08u.seg", &id) == 1) {
+                ids.push_back(id);
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+
+        struct Seen {
+            uint64_t sequence;
+            uint32_t segment;
+            size_t offset; // of the header
+        };
+        std::vector<Seen> seen;
+        std::map<uint64_t, Location> found;
+        for (uint32_t id : ids) {
+            std::shared_ptr<Segment> segment = MapSegment(id, 0, false);
+            size_t offset = 0;
+            while (offset + sizeof(RecordHeader) <= segment->capacity) {
+                RecordHeader header;
+                std::memcpy(&header, segment->data + offset, sizeof(header));
+                size_t bytes = RecordBytes(header.length);
+                if (header.magic != RecordMagic || offset + bytes > segment->capacity) {
+                    break;
+                }
+                seen.push_back(Seen{header.sequence, id, offset});
+                if (header.sequence >= keepFrom) {
+                    found[header.sequence] = Location{id, offset + sizeof(RecordHeader),
+                                                      header.length};
+                }
+                offset += bytes;
+            }
+            segment->used = offset;
+            segments[id] = segment;
+            nextSegment = id + 1;
+        }
+
+        firstIndex = found.empty() ? keepFrom : found.begin()->first;
+        for (const auto& entry : found) {
+            if (entry.first != firstIndex + index.size()) {
+                break;
+            }
+            index.push_back(entry.second);
+        }
+
+        uint64_t end = firstIndex + index.size();
+        for (const Seen& record : seen) {
+            Segment& segment = *segments[record.segment];
+            if (record.sequence >= end && record.offset < segment.used) {
+                ZeroTail(segment, record.offset);
+                segment.used = record.offset;
+            }
+        }
+
+        // Keep appending to the newest segment if it has room, rather
+        // than preallocating a new one on every reopen.
+        if (!segments.empty()) {
+            std::shared_ptr<Segment> tail = segments.rbegin()->second;
+            if (tail->used + RecordBytes(0) <= tail->capacity) {
+                ZeroTail(*tail, tail->used);
+                active = tail;
+            }
+        }
+        compactionRequests = found.empty() ? 0 : 1; // tidy up after the last run
+    }
+
+    void CompactLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || compactionsDone < compactionRequests; });
+            if (stopping) {
+                return;
+            }
+            uint64_t target = compactionRequests;
+            CompactOnce(lock);
+            compactionsDone = target;
+            idle.notify_all();
+        }
+    }
+
+    // Runs with the mutex held, dropping it while copying records.
+    void CompactOnce(std::unique_lock<std::mutex>& lock) {
+        std::map<uint32_t, size_t> liveBytes;
+        for (const Location& location : index) {
+            liveBytes[location.segment] += RecordBytes(location.length);
+        }
+
+        std::vector<std::shared_ptr<Segment>> sealed;
+        for (const auto& entry : segments) {
+            if (entry.second != active) {
+                sealed.push_back(entry.second);
+            }
+        }
+
+        for (const std::shared_ptr<Segment>& segment : sealed) {
+            size_t live = liveBytes[segment->id];
+            if (live * 2 >= segment->used && live != 0) {
+                continue;
+            }
+            if (live != 0) {
+                Rewrite(segment, live, lock);
+            }
+            segments.erase(segment->id);
+            std::filesystem::remove(segment->path);
+        }
+    }
+
+    // Copies the live records of `from` into a new, exactly sized
+    // segment and repoints the index at them. The copy is synced before
+    // the old file goes away.
+    void Rewrite(const std::shared_ptr<Segment>& from, size_t live,
+                 std::unique_lock<std::mutex>& lock) {
+        std::vector<std::pair<uint64_t, Location>> moving;
+        for (size_t i = 0; i < index.size(); ++i) {
+            if (index[i].segment == from->id) {
+                moving.emplace_back(firstIndex + i, index[i]);
+            }
+        }
+        std::shared_ptr<Segment> to = MapSegment(nextSegment++, live, true);
+
+        lock.unlock();
+        size_t offset = 0;
+        std::vector<size_t> offsets;
+        for (const auto& record : moving) {
+            RecordHeader header{RecordMagic, 0, record.first, record.second.length};
+            std::memcpy(to->data + offset, &header, sizeof(header));
+            std::memcpy(to->data + offset + sizeof(header), from->data + record.second.offset,
+                        record.second.length);
+            offsets.push_back(offset + sizeof(header));
+            offset += RecordBytes(record.second.length);
+        }
+        to->used = offset;
+        Sync(*to, 0, to->used);
+        SyncDirectory(); // the new file must exist before the old one goes
+        lock.lock();
+
+        segments[to->id] = to;
+        for (size_t i = 0; i < moving.size(); ++i) {
+            uint64_t sequence = moving[i].first;
+            if (sequence >= firstIndex && sequence - firstIndex < index.size()) {
+                index[sequence - firstIndex].segment = to->id;
+                index[sequence - firstIndex].offset = offsets[i];
+            }
+        }
+    }
+
+    std::string directory;
+    size_t segmentBytes;
+    bool syncEachAppend;
+    size_t pageSize;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::map<uint32_t, std::shared_ptr<Segment>> segments;
+    std::shared_ptr<Segment> active;
+    uint32_t nextSegment = 0;
+    std::deque<Location> index;
+    uint64_t firstIndex = 0;
+    uint64_t compactionRequests = 0;
+    uint64_t compactionsDone = 0;
+    bool stopping = false;
+    std::thread compactor;
 };
 
 int main(int argc, char *argv[])
@@ -80,5 +760,112 @@ int main(int argc, char *argv[])
     originator.RestoreState(caretaker.GetMemento(1));
     std::cout << "Current state: " << originator.GetState() << std::endl;
 
+    // 10 MB document, 10k small edits, a checkpoint after each one.
+    const size_t stateBytes = 10 * 1024 * 1024;
+    const size_t edits = 10000;
+    const size_t keyframeInterval = 1000;
+    std::mt19937 rng(7);
+    Originator document;
+    document.SetState(std::string(stateBytes, 'x'));
+    Caretaker history(keyframeInterval);
+    history.Checkpoint(document);
+
+    // Keep a few full copies to check restores against.
+    std::vector<std::pair<size_t, std::string>> samples;
+    char edit[64];
+    for (size_t i = 1; i <= edits; ++i) {
+        for (char& c : edit) {
+            c = char('a' + rng() % 26);
+        }
+        document.Write(rng() % (stateBytes - sizeof(edit)), std::string_view(edit, sizeof(edit)));
+        history.Checkpoint(document);
+        if (i % 997 == 0) {
+            samples.emplace_back(i, document.GetState());
+        }
+    }
+
+    std::cout << history.Count() << " checkpoints of a 10 MB state: "
+              << history.HistoryBytes() / history.Count() << " bytes per memento (full copies: "
+              << stateBytes << ")\n";
+
+    bool matches = true;
+    Originator restored;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& sample : samples) {
+        history.Restore(sample.first, restored);
+        matches = matches && restored.GetState() == sample.second;
+    }
+    double restoreUs = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count() / samples.size();
+
+    // Views walking forward reuse the buffer and replay one delta each.
+    start = std::chrono::steady_clock::now();
+    size_t checksum = 0;
+    for (size_t i = 1; i < 1000; ++i) {
+        checksum += history.View(i)[i];
+    }
+    double viewUs = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count() / 999;
+
+    std::cout << "Restore latency: " << restoreUs << " us, sequential view: " << viewUs
+              << " us (" << (matches ? "verified" : "MISMATCH") << ", " << checksum << ")\n";
+
+    // Persistent history: 2000 checkpoints of a 64 KB state on disk.
+    std::string storeDir = (std::filesystem::temp_directory_path() / "memento-store").string();
+    std::filesystem::remove_all(storeDir);
+    auto savedState = [](size_t i) {
+        return std::string(64 * 1024, char('a' + i % 26)) + std::to_string(i);
+    };
+    const size_t persisted = 2000;
+    {
+        PersistentCaretaker store(storeDir, size_t(16) << 20);
+        Originator editor;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < persisted; ++i) {
+            editor.SetState(savedState(i));
+            store.AddMemento(editor.CreateMemento());
+        }
+        double appendUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / persisted;
+        std::cout << "Persisted " << persisted << " mementos in " << store.SegmentCount()
+                  << " segments, " << appendUs << " us per synced append\n";
+    }
+
+    // Restart: only the record headers are read back.
+    start = std::chrono::steady_clock::now();
+    PersistentCaretaker store(storeDir, size_t(16) << 20);
+    double reopenMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::mt19937 pick(3);
+    bool intact = store.EndIndex() == persisted;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        size_t index = pick() % persisted;
+        std::string_view bytes = store.GetMemento(index).GetSavedState();
+        intact = intact && bytes[0] == char('a' + index % 26);
+    }
+    double mapNs = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / 1000;
+    store.Restore(1234, restored);
+    intact = intact && restored.GetState() == savedState(1234);
+    std::cout << "Reopened in " << reopenMs << " ms, restore by mapping: " << mapNs << " ns ("
+              << (intact ? "verified" : "MISMATCH") << ")\n";
+
+    // Keep the last 500; the compactor reclaims the rest.
+    size_t diskBefore = store.DiskBytes();
+    {
+        PersistentCaretaker::MappedMemento held = store.GetMemento(100); // survives compaction
+        store.Forget(persisted - 500);
+        store.WaitForCompaction();
+        intact = held.GetSavedState() == savedState(100);
+    }
+    store.Restore(persisted - 1, restored);
+    intact = intact && restored.GetState() == savedState(persisted - 1);
+    std::cout << "Compacted " << diskBefore / (1024 * 1024) << " MB to "
+              << store.DiskBytes() / (1024 * 1024) << " MB in " << store.SegmentCount()
+              << " segments, indices " << store.FirstIndex() << ".." << store.EndIndex() - 1
+              << " (" << (intact ? "verified" : "MISMATCH") << ")\n";
+
     return a.exec();
 }
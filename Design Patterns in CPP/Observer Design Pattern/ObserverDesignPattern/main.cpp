@@ -1,32 +1,524 @@
 #include <QCoreApplication>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Rolling statistics of one measurement column.
+struct ColumnStats {
+    float min = 0;
+    float max = 0;
+    float mean = 0;
+};
+
+// Read-only view of one ingested batch (structure of arrays) plus rolling
+// statistics over the station's recent-history window. Only valid for the
+// duration of the updateBatch() call.
+struct MeasurementBatchView {
+    const float* temperature;
+    const float* humidity;
+    const float* pressure;
+    size_t count;
+    ColumnStats temperatureStats;
+    ColumnStats humidityStats;
+    ColumnStats pressureStats;
+    size_t windowSize;
+};
+
 // Observer interface
 class Observer {
 public:
     virtual void update(float temperature, float humidity, float pressure) = 0;
+
+    // Called once per setMeasurementsBatch(). By default the observer
+    // only sees the latest reading of the batch.
+    virtual void updateBatch(const MeasurementBatchView& batch) {
+        if (batch.count > 0) {
+            size_t last = batch.count - 1;
+            update(batch.temperature[last], batch.humidity[last], batch.pressure[last]);
+        }
+    }
+};
+
+// Min, max and mean of a column, four lanes at a time where SSE2 is there.
+// The sum is accumulated in double on both paths, so the vector and scalar
+// means agree.
+inline ColumnStats computeColumnStats(const float* data, size_t count) {
+    ColumnStats stats;
+    if (count == 0) {
+        return stats;
+    }
+    float lo = std::numeric_limits<float>::infinity();
+    float hi = -lo;
+    double sum = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128 vlo = _mm_set1_ps(lo);
+    __m128 vhi = _mm_set1_ps(hi);
+    __m128d sumLow = _mm_setzero_pd();
+    __m128d sumHigh = _mm_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(data + i);
+        vlo = _mm_min_ps(vlo, x);
+        vhi = _mm_max_ps(vhi, x);
+        sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(x));
+        sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, vlo);
+    lo = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+    _mm_store_ps(lanes, vhi);
+    hi = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    alignas(16) double sums[2];
+    _mm_store_pd(sums, _mm_add_pd(sumLow, sumHigh));
+    sum = sums[0] + sums[1];
+#endif
+    for (; i < count; ++i) {
+        lo = std::min(lo, data[i]);
+        hi = std::max(hi, data[i]);
+        sum += data[i];
+    }
+    stats.min = lo;
+    stats.max = hi;
+    stats.mean = static_cast<float>(sum / count);
+    return stats;
+}
+
+// Fixed-size columnar ring of the most recent readings, one contiguous
+// array per quantity.
+class MeasurementRing {
+private:
+    std::vector<float> columns[3];
+    size_t head = 0; // next write position
+    size_t filled = 0;
+
+public:
+    explicit MeasurementRing(size_t capacity) {
+        for (std::vector<float>& column : columns) {
+            column.resize(capacity);
+        }
+    }
+
+    size_t size() const { return filled; }
+
+    void append(const float* temperature, const float* humidity, const float* pressure,
+                size_t count) {
+        size_t capacity = columns[0].size();
+        if (count > capacity) { // only the newest readings fit
+            temperature += count - capacity;
+            humidity += count - capacity;
+            pressure += count - capacity;
+            count = capacity;
+        }
+        const float* sources[3] = {temperature, humidity, pressure};
+        size_t first = std::min(count, capacity - head);
+        for (int c = 0; c < 3; ++c) {
+            std::copy(sources[c], sources[c] + first, columns[c].begin() + head);
+            std::copy(sources[c] + first, sources[c] + count, columns[c].begin());
+        }
+        head = (head + count) % capacity;
+        filled = std::min(capacity, filled + count);
+    }
+
+    // Statistics ignore order, so the filled part is scanned as is.
+    ColumnStats stats(int column) const {
+        return computeColumnStats(columns[column].data(), filled);
+    }
+};
+
+// One weather reading, numbered in publish order.
+struct Measurement {
+    float temperature;
+    float humidity;
+    float pressure;
+    uint64_t sequence;
+};
+
+// What to do when an observer's queue is full.
+enum class BackpressurePolicy {
+    DropOldest, // discard the oldest queued reading
+    Coalesce,   // keep only the latest reading (queue of one)
+    Block,      // make the publishing thread wait; see AsyncDispatcher
+};
+
+struct DispatchOptions {
+    unsigned workers = 2;
+    size_t queueCapacity = 16;
+    BackpressurePolicy policy = BackpressurePolicy::Coalesce;
+};
+
+struct ObserverStats {
+    uint64_t delivered = 0;
+    uint64_t dropped = 0; // discarded or coalesced away
+    uint64_t lag = 0;     // readings published since the last one delivered
+};
+
+// Delivers readings on a worker pool. Each observer has its own bounded
+// mailbox and is updated by at most one worker at a time, in order, so a
+// slow observer only delays itself.
+//
+// With BackpressurePolicy::Block the publisher waits for a full mailbox
+// while holding the publish lock, so an observer must not call back into
+// the station (setMeasurements*, observerStats) from update(): it would
+// wait for that lock while the publisher waits for it. Use DropOldest or
+// Coalesce for observers that republish.
+class AsyncDispatcher {
+private:
+    struct Mailbox {
+        Observer* observer;
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::deque<Measurement> queue;
+        bool scheduled = false; // sitting in the ready queue or being drained
+        bool detached = false;  // observer was removed
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> lastDelivered{0};
+
+        explicit Mailbox(Observer* o) : observer(o) {}
+    };
+
+    DispatchOptions options;
+
+    std::mutex readyMutex;
+    std::condition_variable readyCondition;
+    std::deque<Mailbox*> ready;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    // Mailboxes for the observer snapshot seen last; rebuilt only when
+    // the station publishes a new observer list.
+    std::mutex publishMutex;
+    std::unordered_map<Observer*, std::unique_ptr<Mailbox>> mailboxes;
+    // Detached mailboxes a worker still holds; freed once it lets go.
+    std::unordered_map<Observer*, std::unique_ptr<Mailbox>> retired;
+    std::shared_ptr<const std::vector<Observer*>> currentList;
+    std::vector<Mailbox*> targets;
+    std::atomic<uint64_t> published{0};
+    std::atomic<int64_t> pending{0};
+
+public:
+    explicit AsyncDispatcher(const DispatchOptions& opts) : options(opts) {
+        if (options.policy == BackpressurePolicy::Coalesce || options.queueCapacity == 0) {
+            options.queueCapacity = 1;
+        }
+        unsigned count = options.workers == 0 ? 1 : options.workers;
+        for (unsigned i = 0; i < count; ++i) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~AsyncDispatcher() {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            stopping = true;
+        }
+        readyCondition.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    void publish(const std::shared_ptr<const std::vector<Observer*>>& list,
+                 float temperature, float humidity, float pressure) {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        if (list != currentList) {
+            retarget(list);
+        }
+        Measurement reading{temperature, humidity, pressure, ++published};
+        for (Mailbox* box : targets) {
+            enqueue(*box, reading);
+        }
+    }
+
+    // Waits until every queued reading has been delivered or dropped.
+    void flush() {
+        while (pending.load() > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    ObserverStats stats(Observer* observer) {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        ObserverStats result;
+        auto it = mailboxes.find(observer);
+        if (it != mailboxes.end()) {
+            Mailbox& box = *it->second;
+            result.delivered = box.delivered.load();
+            result.dropped = box.dropped.load();
+            result.lag = published.load() - box.lastDelivered.load();
+        }
+        return result;
+    }
+
+private:
+    void retarget(const std::shared_ptr<const std::vector<Observer*>>& list) {
+        currentList = list;
+        targets.clear();
+        for (auto& entry : mailboxes) {
+            entry.second->detached = true;
+        }
+        for (Observer* observer : *list) {
+            std::unique_ptr<Mailbox>& box = mailboxes[observer];
+            if (!box) {
+                // Revive a retired mailbox rather than open a second one,
+                // which a worker could drain concurrently with the first.
+                auto old = retired.find(observer);
+                if (old != retired.end()) {
+                    box = std::move(old->second);
+                    retired.erase(old);
+                } else {
+                    box = std::make_unique<Mailbox>(observer);
+                }
+            }
+            box->detached = false;
+            targets.push_back(box.get());
+        }
+        for (auto it = mailboxes.begin(); it != mailboxes.end();) {
+            Mailbox& box = *it->second;
+            bool busy;
+            {
+                std::lock_guard<std::mutex> lock(box.mutex);
+                if (!box.detached) {
+                    ++it;
+                    continue;
+                }
+                if (!box.queue.empty()) {
+                    pending.fetch_sub(static_cast<int64_t>(box.queue.size()));
+                    box.queue.clear();
+                    box.notFull.notify_all();
+                }
+                busy = box.scheduled;
+            }
+            if (busy) {
+                retired[it->first] = std::move(it->second);
+            }
+            it = mailboxes.erase(it);
+        }
+        // A retired mailbox is no longer scheduled once its worker has
+        // seen the empty queue; nothing references it after that.
+        for (auto it = retired.begin(); it != retired.end();) {
+            bool busy;
+            {
+                std::lock_guard<std::mutex> lock(it->second->mutex);
+                busy = it->second->scheduled;
+            }
+            it = busy ? std::next(it) : retired.erase(it);
+        }
+    }
+
+    void enqueue(Mailbox& box, const Measurement& reading) {
+        std::unique_lock<std::mutex> lock(box.mutex);
+        if (box.queue.size() >= options.queueCapacity) {
+            if (options.policy == BackpressurePolicy::Block) {
+                box.notFull.wait(lock, [&] {
+                    return box.queue.size() < options.queueCapacity || box.detached;
+                });
+            } else {
+                // DropOldest and Coalesce (capacity 1) both evict the front.
+                box.queue.pop_front();
+                box.dropped.fetch_add(1, std::memory_order_relaxed);
+                pending.fetch_sub(1);
+            }
+        }
+        box.queue.push_back(reading);
+        pending.fetch_add(1);
+        if (!box.scheduled) {
+            box.scheduled = true;
+            lock.unlock();
+            std::lock_guard<std::mutex> readyLock(readyMutex);
+            ready.push_back(&box);
+            readyCondition.notify_one();
+        }
+    }
+
+    void run() {
+        for (;;) {
+            Mailbox* box;
+            {
+                std::unique_lock<std::mutex> lock(readyMutex);
+                readyCondition.wait(lock, [this] { return stopping || !ready.empty(); });
+                if (ready.empty()) {
+                    return;
+                }
+                box = ready.front();
+                ready.pop_front();
+            }
+            drain(*box);
+        }
+    }
+
+    // Delivers a few readings, then yields the worker so one busy mailbox
+    // cannot starve the rest.
+    void drain(Mailbox& box) {
+        for (int delivered = 0;; ++delivered) {
+            Measurement reading;
+            {
+                std::lock_guard<std::mutex> lock(box.mutex);
+                if (box.queue.empty()) {
+                    box.scheduled = false;
+                    return;
+                }
+                if (delivered == 8) {
+                    std::lock_guard<std::mutex> readyLock(readyMutex);
+                    ready.push_back(&box);
+                    readyCondition.notify_one();
+                    return;
+                }
+                reading = box.queue.front();
+                box.queue.pop_front();
+                box.notFull.notify_one();
+            }
+            box.observer->update(reading.temperature, reading.humidity, reading.pressure);
+            box.lastDelivered.store(reading.sequence);
+            box.delivered.fetch_add(1, std::memory_order_relaxed);
+            pending.fetch_sub(1);
+        }
+    }
 };
 
 // Subject (WeatherStation) class
 class WeatherStation {
 private:
+    using ObserverList = std::vector<Observer*>;
+
     float temperature;
     float humidity;
     float pressure;
-    std::vector<Observer*> observers;
+
+    // Copy-on-write: the list is never modified in place. Writers build a
+    // new list and publish it atomically; notifyObservers iterates whatever
+    // snapshot it loaded, so (un)subscribing from a callback or another
+    // thread is safe. removeObserver() waits out notifies that may still
+    // hold the old list (see waitForNotifies()).
+    std::shared_ptr<const ObserverList> observers = std::make_shared<const ObserverList>();
+    std::mutex writeMutex; // serialises writers only
+    std::unique_ptr<AsyncDispatcher> dispatcher;
+    MeasurementRing history{4096};
+
+    // Notifies in flight, counted per grace period: a notify registers
+    // under the current parity before loading the list, so once the parity
+    // flips, the old counter only drains and new notifies cannot starve a
+    // waiting removeObserver().
+    std::atomic<long> inFlight[2] = {{0}, {0}};
+    std::atomic<unsigned> parity{0};
+    std::mutex graceMutex; // one grace period at a time
+
+    // Marks the calling thread as notifying for this station for its
+    // lifetime. Scopes form a thread-local stack so removeObserver() can
+    // tell that it is being called from one of this station's callbacks.
+    class NotifyScope {
+    public:
+        explicit NotifyScope(WeatherStation& station)
+            : station(station), slot(station.parity.load() & 1), outer(innermost) {
+            station.inFlight[slot].fetch_add(1);
+            innermost = this;
+        }
+        ~NotifyScope() {
+            innermost = outer;
+            station.inFlight[slot].fetch_sub(1, std::memory_order_release);
+        }
+        NotifyScope(const NotifyScope&) = delete;
+        NotifyScope& operator=(const NotifyScope&) = delete;
+
+        static bool active(const WeatherStation& station) {
+            for (const NotifyScope* scope = innermost; scope; scope = scope->outer) {
+                if (&scope->station == &station) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        WeatherStation& station;
+        unsigned slot;
+        NotifyScope* outer;
+        static thread_local NotifyScope* innermost;
+    };
+
+    template <typename Edit>
+    void publish(Edit edit) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        auto next = std::make_shared<ObserverList>(*std::atomic_load(&observers));
+        edit(*next);
+        std::atomic_store(&observers, std::shared_ptr<const ObserverList>(std::move(next)));
+    }
+
+    // Returns once every notify that started before the call has finished.
+    // Notifies are short, so the wait yields rather than sleeps.
+    void waitForNotifies() {
+        std::lock_guard<std::mutex> lock(graceMutex);
+        unsigned old = parity.fetch_add(1) & 1;
+        while (inFlight[old].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
 
 public:
     void registerObserver(Observer* observer) {
-        observers.push_back(observer);
+        publish([observer](ObserverList& list) { list.push_back(observer); });
     }
 
+    // In synchronous mode, returns only after concurrent notifies that
+    // could still reach observer have finished, so it may be destroyed
+    // right away. Called from inside one of this station's callbacks it
+    // cannot wait for its own notify: the observer may still get that
+    // notify's remaining update and must outlive it.
     void removeObserver(Observer* observer) {
-        // You can implement the removal logic if needed.
+        publish([observer](ObserverList& list) {
+            list.erase(std::remove(list.begin(), list.end(), observer), list.end());
+        });
+        if (!NotifyScope::active(*this)) {
+            waitForNotifies();
+        }
+    }
+
+    // Switches to asynchronous delivery: setMeasurements() queues the
+    // reading per observer and returns immediately.
+    void enableAsyncDispatch(const DispatchOptions& options = DispatchOptions()) {
+        dispatcher = std::make_unique<AsyncDispatcher>(options);
+    }
+
+    // Back to synchronous delivery, after draining queued readings.
+    void disableAsyncDispatch() { dispatcher.reset(); }
+
+    // Blocks until queued readings are delivered. In async mode, call this
+    // after removeObserver() before destroying the observer.
+    void flush() {
+        if (dispatcher) {
+            dispatcher->flush();
+        }
+    }
+
+    // Per-observer delivery counters (async mode only).
+    ObserverStats observerStats(Observer* observer) {
+        return dispatcher ? dispatcher->stats(observer) : ObserverStats();
     }
 
     void notifyObservers() {
-        for (Observer* observer : observers) {
+        NotifyScope scope(*this);
+        std::shared_ptr<const ObserverList> snapshot = std::atomic_load(&observers);
+        if (dispatcher) {
+            dispatcher->publish(snapshot, temperature, humidity, pressure);
+            return;
+        }
+        for (Observer* observer : *snapshot) {
             observer->update(temperature, humidity, pressure);
         }
     }
@@ -37,8 +529,36 @@ public:
         pressure = press;
         notifyObservers();
     }
+    // Ingests a burst of readings given as parallel arrays, stores them in
+    // the columnar history and notifies each observer once. In async mode
+    // observers get only the last reading of the batch.
+    void setMeasurementsBatch(const float* temps, const float* hums, const float* presses,
+                              size_t count) {
+        if (count == 0) {
+            return;
+        }
+        history.append(temps, hums, presses, count);
+        temperature = temps[count - 1];
+        humidity = hums[count - 1];
+        pressure = presses[count - 1];
+
+        NotifyScope scope(*this);
+        std::shared_ptr<const ObserverList> snapshot = std::atomic_load(&observers);
+        if (dispatcher) {
+            dispatcher->publish(snapshot, temperature, humidity, pressure);
+            return;
+        }
+        MeasurementBatchView view{temps, hums, presses, count,
+                                  history.stats(0), history.stats(1), history.stats(2),
+                                  history.size()};
+        for (Observer* observer : *snapshot) {
+            observer->updateBatch(view);
+        }
+    }
 };
 
+thread_local WeatherStation::NotifyScope* WeatherStation::NotifyScope::innermost = nullptr;
+
 // Concrete Observer
 class Display : public Observer {
     std::string name;
@@ -72,5 +592,143 @@ int main(int argc, char *argv[])
     weatherStation.setMeasurements(25.5, 60, 1013.2);
     weatherStation.setMeasurements(24.8, 58, 1014.5);
 
+    // Unsubscribe one display: only Display 1 sees the next reading.
+    weatherStation.removeObserver(&display2);
+    weatherStation.setMeasurements(23.9, 55, 1015.1);
+
+    // Notify throughput with 10k observers while two threads keep
+    // subscribing and unsubscribing.
+    struct Counter : Observer {
+        std::atomic<long> updates{0};
+        void update(float, float, float) override {
+            updates.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    WeatherStation busyStation;
+    std::vector<Counter> counters(10000);
+    for (Counter& counter : counters) {
+        busyStation.registerObserver(&counter);
+    }
+
+    std::atomic<bool> running{true};
+    std::atomic<long> churned{0};
+    std::vector<std::thread> churners;
+    for (int t = 0; t < 2; ++t) {
+        churners.emplace_back([&] {
+            Counter transient;
+            while (running.load()) {
+                busyStation.registerObserver(&transient);
+                busyStation.removeObserver(&transient);
+                churned.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    const int notifications = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < notifications; ++i) {
+        busyStation.setMeasurements(20.0f + i % 10, 50, 1013);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    running.store(false);
+    for (std::thread& t : churners) {
+        t.join();
+    }
+
+    std::cout << "10k observers: " << static_cast<long>(notifications / elapsed)
+              << " notifies/sec (" << static_cast<long>(notifications * 10000.0 / elapsed)
+              << " updates/sec) with " << churned.load() << " concurrent subscribe/unsubscribe pairs"
+              << std::endl;
+
+    // Asynchronous dispatch: a slow observer only sees the latest reading
+    // and does not hold up ingestion or the fast observer.
+    struct Recorder : Observer {
+        std::chrono::milliseconds delay;
+        float lastTemperature = 0;
+        explicit Recorder(std::chrono::milliseconds d) : delay(d) {}
+        void update(float temperature, float, float) override {
+            std::this_thread::sleep_for(delay);
+            lastTemperature = temperature;
+        }
+    };
+
+    WeatherStation asyncStation;
+    Recorder fast(std::chrono::milliseconds(0));
+    Recorder slow(std::chrono::milliseconds(20));
+    asyncStation.registerObserver(&fast);
+    asyncStation.registerObserver(&slow);
+
+    DispatchOptions options;
+    options.policy = BackpressurePolicy::Coalesce;
+    asyncStation.enableAsyncDispatch(options);
+
+    auto ingestStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < 200; ++i) {
+        asyncStation.setMeasurements(float(i), 50, 1013);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    auto ingestTime = std::chrono::steady_clock::now() - ingestStart;
+    ObserverStats slowLag = asyncStation.observerStats(&slow);
+    asyncStation.flush();
+
+    for (Recorder* recorder : {&fast, &slow}) {
+        ObserverStats stats = asyncStation.observerStats(recorder);
+        std::cout << (recorder == &fast ? "Fast" : "Slow") << " observer: delivered "
+                  << stats.delivered << ", dropped " << stats.dropped
+                  << ", last temperature " << recorder->lastTemperature << std::endl;
+    }
+    std::cout << "Ingested 200 readings in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(ingestTime).count()
+              << " ms; slow observer lag before flush: " << slowLag.lag << std::endl;
+    asyncStation.disableAsyncDispatch();
+
+    // Batched columnar ingestion versus one reading at a time.
+    struct Aggregator : Observer {
+        double sum = 0;
+        float windowMax = 0;
+        void update(float temperature, float, float) override { sum += temperature; }
+        void updateBatch(const MeasurementBatchView& batch) override {
+            for (size_t i = 0; i < batch.count; ++i) {
+                sum += batch.temperature[i];
+            }
+            windowMax = batch.temperatureStats.max;
+        }
+    };
+
+    const size_t readings = 1 << 20;
+    const size_t burst = 4096;
+    std::vector<float> temps(readings), hums(readings), presses(readings);
+    for (size_t i = 0; i < readings; ++i) {
+        temps[i] = 15.0f + (i * 7 % 200) / 10.0f;
+        hums[i] = 40.0f + (i % 50);
+        presses[i] = 1000.0f + (i % 30);
+    }
+
+    WeatherStation perReading;
+    WeatherStation batched;
+    std::vector<Aggregator> slowSide(8), fastSide(8);
+    for (size_t i = 0; i < slowSide.size(); ++i) {
+        perReading.registerObserver(&slowSide[i]);
+        batched.registerObserver(&fastSide[i]);
+    }
+
+    auto perStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < readings; ++i) {
+        perReading.setMeasurements(temps[i], hums[i], presses[i]);
+    }
+    double perSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - perStart).count();
+
+    auto batchStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < readings; i += burst) {
+        batched.setMeasurementsBatch(&temps[i], &hums[i], &presses[i], burst);
+    }
+    double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+
+    std::cout << "Per-reading: " << static_cast<long>(readings / perSeconds)
+              << " readings/sec, batched: " << static_cast<long>(readings / batchSeconds)
+              << " readings/sec (sums " << slowSide[0].sum << " / " << fastSide[0].sum
+              << ", window max " << fastSide[0].windowMax << ")" << std::endl;
+
     return a.exec();
 }